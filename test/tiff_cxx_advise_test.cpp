@@ -0,0 +1,196 @@
+#include "tiff_cxx.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <algorithm>
+#include <filesystem>
+
+// a source recording the hints it gets shows that stepping through frames, projecting them and reading regions
+// give every hint (within the file), and the same reads go through every backend, hints and all, without an error
+
+static const uint32_t width = 64;
+static const uint32_t height = 48;
+static const uint32_t frames = 4;
+
+class HintSource : public tiff::reader::ByteSource
+{
+public:
+	struct Hint
+	{
+		uint64_t offset;
+		uint64_t size;
+		tiff::reader::AccessHint hint;
+	};
+
+	HintSource(std::vector<uint8_t> bytes)
+		: _bytes(std::move(bytes))
+	{
+	}
+
+	uint64_t size() const noexcept override
+	{
+		return _bytes.size();
+	}
+
+	uint64_t read_at(uint64_t offset, void* buffer, uint64_t count) noexcept override
+	{
+		if (offset >= _bytes.size())
+		{
+			return 0;
+		}
+		count = std::min<uint64_t>(count, _bytes.size() - offset);
+		std::copy(_bytes.begin() + offset, _bytes.begin() + offset + count, (uint8_t*)buffer);
+		return count;
+	}
+
+	void advise(uint64_t offset, uint64_t size, tiff::reader::AccessHint hint) noexcept override
+	{
+		hints.push_back({ offset, size, hint });
+	}
+
+	std::vector<Hint> hints{};
+
+private:
+	std::vector<uint8_t> _bytes{};
+};
+
+static bool write_file(const std::filesystem::path& path)
+{
+	tiff::writer::FrameInfo info{};
+	info.width = width;
+	info.height = height;
+	info.bits_per_sample = 16;
+	info.samples_per_pixel = 1;
+	info.rows_per_strip = 8;
+
+	tiff::writer::Writer writer{ path };
+	if (writer.open() != tiff::Error::NoError)
+	{
+		return false;
+	}
+	for (uint32_t frame = 0; frame < frames; ++frame)
+	{
+		std::vector<uint16_t> pixels(size_t(width) * height);
+		for (size_t i = 0; i < pixels.size(); ++i)
+		{
+			pixels[i] = uint16_t(i + frame * 1000);
+		}
+		if (writer.write_frame(info, pixels.data()) != tiff::Error::NoError)
+		{
+			return false;
+		}
+	}
+	return writer.close() == tiff::Error::NoError;
+}
+
+// steps through the frames reading a region of each, then projects them, so that every hint is given
+static bool read_with_hints(tiff::reader::Reader& reader, std::vector<uint16_t>& samples)
+{
+	std::vector<uint16_t> buffer(size_t(width) * height);
+	for (uint32_t frame = 0; frame < frames; ++frame)
+	{
+		if (frame != 0 && reader.read_next_frame() != tiff::Error::NoError)
+		{
+			return false;
+		}
+		if (reader.read_region(0, 0, tiff::Rect{ 5, 3, 17, 29 }, buffer.data(), buffer.size() * 2) != tiff::Error::NoError)
+		{
+			return false;
+		}
+		samples.insert(samples.end(), buffer.begin(), buffer.begin() + 17 * 29);
+	}
+	if (reader.project_frames(0, tiff::ProjectionMode::Max, 0, 0, buffer.data(), buffer.size() * 2) != tiff::Error::NoError)
+	{
+		return false;
+	}
+	samples.insert(samples.end(), buffer.begin(), buffer.end());
+	return true;
+}
+
+static bool check_hints(const std::filesystem::path& path, std::vector<uint16_t>& samples)
+{
+	std::ifstream stream{ path, std::ios::binary };
+	const std::vector<uint8_t> bytes{ std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>() };
+	stream.close();
+
+	auto source = std::make_shared<HintSource>(bytes);
+	tiff::reader::Reader reader{ source };
+	if (reader.open() != tiff::Error::NoError || !read_with_hints(reader, samples))
+	{
+		std::cerr << "reading through the hint source failed\n";
+		return false;
+	}
+	bool ok = true;
+	for (tiff::reader::AccessHint hint : { tiff::reader::AccessHint::Sequential, tiff::reader::AccessHint::Random,
+		tiff::reader::AccessHint::WillNeed, tiff::reader::AccessHint::DontNeed })
+	{
+		if (std::none_of(source->hints.begin(), source->hints.end(), [hint](const HintSource::Hint& h) { return h.hint == hint; }))
+		{
+			std::cerr << "hint " << int(hint) << " was never given\n";
+			ok = false;
+		}
+	}
+	for (const HintSource::Hint& h : source->hints)
+	{
+		// patterns cover the whole file, frames their strips
+		const bool pattern = h.hint == tiff::reader::AccessHint::Sequential || h.hint == tiff::reader::AccessHint::Random;
+		if (pattern ? (h.offset != 0 || h.size != 0) : (h.size == 0 || h.offset + h.size > bytes.size()))
+		{
+			std::cerr << "hint " << int(h.hint) << " covers " << h.size << " bytes at " << h.offset << "\n";
+			ok = false;
+		}
+	}
+	return ok;
+}
+
+int main()
+{
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "tinytiff_cxx_advise.tif";
+	if (!write_file(path))
+	{
+		std::cerr << "writing the file failed\n";
+		return 1;
+	}
+
+	std::vector<uint16_t> reference{};
+	bool ok = check_hints(path, reference);
+
+	const std::pair<tiff::IoBackend, const char*> backends[]{
+		{ tiff::IoBackend::Stream, "stream" },
+		{ tiff::IoBackend::IoUring, "io_uring" },
+		{ tiff::IoBackend::Mmap, "mmap" },
+		{ tiff::IoBackend::Direct, "direct" },
+	};
+	for (const auto& backend : backends)
+	{
+		tiff::reader::Reader reader{ path };
+		const tiff::Error err = reader.set_io_backend(backend.first);
+		if (err == tiff::Error::IoBackendNotSupport)
+		{
+			continue;
+		}
+		std::vector<uint16_t> samples{};
+		if (err != tiff::Error::NoError || reader.open() != tiff::Error::NoError || !read_with_hints(reader, samples))
+		{
+			std::cerr << backend.second << ": reading with hints failed\n";
+			ok = false;
+		}
+		else if (samples != reference)
+		{
+			std::cerr << backend.second << ": the samples differ\n";
+			ok = false;
+		}
+	}
+
+	std::error_code ec{};
+	std::filesystem::remove(path, ec);
+	if (ok)
+	{
+		std::cout << "every hint taken\n";
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,298 @@
+#include "tiff_cxx.h"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+
+// files read through each I/O backend (chosen before and after open) are compared byte for byte to the stream backend:
+// strips and tiles, regions off every block (and 4 KiB) boundary, whole volumes with read sizes of a few rows up to a frame,
+// and a file cut off inside its last strip, whose short reads are finished (with nothing) by pread. no file ends on a
+// 4 KiB boundary, so the widened direct reads always run past the end
+
+static const uint32_t width = 203;
+static const uint32_t height = 157;
+static const uint16_t samples = 2;
+static const uint32_t frames = 3;
+
+struct Backend
+{
+	tiff::IoBackend backend;
+	const char* name;
+};
+
+static const std::vector<Backend> backends{
+	{ tiff::IoBackend::IoUring, "io_uring" },
+	{ tiff::IoBackend::Mmap, "mmap" },
+	{ tiff::IoBackend::Direct, "direct" },
+};
+
+static bool write_file(const std::filesystem::path& path, uint32_t tile_size)
+{
+	tiff::writer::FrameInfo info{};
+	info.width = width;
+	info.height = height;
+	info.bits_per_sample = 16;
+	info.samples_per_pixel = samples;
+	info.rows_per_strip = 7;
+	info.tile_width = tile_size;
+	info.tile_length = tile_size;
+
+	tiff::writer::Writer writer{ path };
+	if (writer.open() != tiff::Error::NoError)
+	{
+		return false;
+	}
+	for (uint32_t frame = 0; frame < frames; ++frame)
+	{
+		std::vector<uint16_t> pixels(size_t(width) * height * samples);
+		for (size_t i = 0; i < pixels.size(); ++i)
+		{
+			pixels[i] = uint16_t(i * 7 + frame * 3571);
+		}
+		if (writer.write_frame(info, pixels.data()) != tiff::Error::NoError)
+		{
+			return false;
+		}
+	}
+	return writer.close() == tiff::Error::NoError;
+}
+
+// 16 bit strips of one sample placed after the IFD, the last one cut to `last_strip_bytes`
+static bool write_cut_file(const std::filesystem::path& path, uint32_t cut_width, uint32_t cut_height, uint32_t rows_per_strip,
+	uint32_t last_strip_bytes)
+{
+	const uint32_t strips = (cut_height + rows_per_strip - 1) / rows_per_strip;
+	const uint32_t ifd = 8;
+	const uint32_t entries = 9;
+	const uint32_t offsets_at = ifd + 2 + entries * 12 + 4;
+	const uint32_t counts_at = offsets_at + strips * 4;
+	const uint32_t data_at = counts_at + strips * 4;
+
+	std::vector<uint8_t> file(data_at, 0);
+	auto put = [&file](uint64_t value, uint32_t bytes, size_t at)
+	{
+		for (uint32_t b = 0; b < bytes; ++b)
+		{
+			file[at + b] = uint8_t(value >> (b * 8));
+		}
+	};
+	file[0] = file[1] = 'I';
+	put(42, 2, 2);
+	put(ifd, 4, 4);
+
+	const uint32_t values[entries][4]{
+		{ 256, 4, 1, cut_width },
+		{ 257, 4, 1, cut_height },
+		{ 258, 3, 1, 16 },
+		{ 259, 3, 1, 1 },
+		{ 262, 3, 1, 1 },
+		{ 273, 4, strips, offsets_at },
+		{ 277, 3, 1, 1 },
+		{ 278, 4, 1, rows_per_strip },
+		{ 279, 4, strips, counts_at },
+	};
+	put(entries, 2, ifd);
+	for (uint32_t i = 0; i < entries; ++i)
+	{
+		const size_t at = ifd + 2 + i * 12;
+		put(values[i][0], 2, at);
+		put(values[i][1], 2, at + 2);
+		put(values[i][2], 4, at + 4);
+		put(values[i][3], values[i][1] == 3 ? 2 : 4, at + 8);
+	}
+
+	uint32_t strip_at = data_at;
+	for (uint32_t s = 0; s < strips; ++s)
+	{
+		const uint32_t rows = std::min(rows_per_strip, cut_height - s * rows_per_strip);
+		const uint32_t bytes = rows * cut_width * 2;
+		put(strip_at, 4, offsets_at + s * 4);
+		put(bytes, 4, counts_at + s * 4);
+		file.resize(file.size() + bytes);
+		for (uint32_t i = 0; i < bytes / 2; ++i)
+		{
+			put(uint16_t(1 + i * 3 + s * 1009), 2, strip_at + i * 2);
+		}
+		strip_at += bytes;
+	}
+	file.resize(file.size() - (std::min(cut_height - (strips - 1) * rows_per_strip, rows_per_strip) * cut_width * 2 - last_strip_bytes));
+
+	std::ofstream stream{ path, std::ios::binary };
+	stream.write((const char*)file.data(), std::streamsize(file.size()));
+	return stream.good();
+}
+
+struct Reads
+{
+	std::vector<uint16_t> samples{};
+	std::vector<tiff::Error> errors{};
+};
+
+static void read_region(tiff::reader::Reader& reader, uint16_t sample, const tiff::Rect& region, Reads& out)
+{
+	std::vector<uint16_t> buffer(size_t(region.width) * region.height, 0xdead);
+	out.errors.emplace_back(reader.read_region(0, sample, region, buffer.data(), buffer.size() * 2));
+	out.samples.insert(out.samples.end(), buffer.begin(), buffer.end());
+}
+
+// every frame whole and in part sample by sample, then all frames in one volume
+static tiff::Error read_file(const std::filesystem::path& path, const Backend* backend, bool set_after_open, size_t max_read_size, Reads& out)
+{
+	tiff::reader::Reader reader{ path };
+	if (backend != nullptr && !set_after_open)
+	{
+		const tiff::Error err = reader.set_io_backend(backend->backend);
+		if (err != tiff::Error::NoError)
+		{
+			return err;
+		}
+	}
+	reader.set_max_read_size(max_read_size);
+	tiff::Error err = reader.open();
+	if (err != tiff::Error::NoError)
+	{
+		return err;
+	}
+	if (backend != nullptr && set_after_open)
+	{
+		err = reader.set_io_backend(backend->backend);
+		if (err != tiff::Error::NoError)
+		{
+			return err;
+		}
+	}
+
+	const uint32_t file_frames = reader.count_frames();
+	const uint32_t file_width = reader.width();
+	const uint32_t file_height = reader.height();
+	const uint16_t file_samples = reader.samples_per_pixel();
+	for (uint32_t frame = 0; frame < file_frames; ++frame)
+	{
+		if (frame != 0)
+		{
+			out.errors.emplace_back(reader.read_next_frame());
+		}
+		for (uint16_t c = 0; c < file_samples; ++c)
+		{
+			read_region(reader, c, tiff::Rect{ 0, 0, file_width, file_height }, out);
+			read_region(reader, c, tiff::Rect{ 3, 5, file_width - 9, file_height - 12 }, out);
+			read_region(reader, c, tiff::Rect{ file_width - 1, 1, 1, file_height - 1 }, out);
+		}
+	}
+	std::vector<uint16_t> volume(size_t(file_width) * file_height * file_samples * file_frames, 0xdead);
+	out.errors.emplace_back(reader.read_frames(0, file_frames, 0, file_samples, tiff::reader::OutputLayout{}, volume.data(), volume.size() * 2));
+	out.samples.insert(out.samples.end(), volume.begin(), volume.end());
+	return tiff::Error::NoError;
+}
+
+static bool compare_backends(const std::filesystem::path& path, const std::string& name, tiff::Error expected)
+{
+	// direct reads are widened to whole 4 KiB blocks, the last one has to run past the end of the file
+	std::error_code ec{};
+	if (std::filesystem::file_size(path, ec) % 4096 == 0)
+	{
+		std::cerr << name << ": the file ends on a 4 KiB boundary\n";
+		return false;
+	}
+	bool ok = true;
+	for (size_t max_read_size : { size_t(1000), size_t(4) * 1024 * 1024 })
+	{
+		Reads reference{};
+		if (read_file(path, nullptr, false, max_read_size, reference) != tiff::Error::NoError)
+		{
+			std::cerr << name << ": the stream backend failed to open the file\n";
+			return false;
+		}
+		const bool failed_as_expected = (expected == tiff::Error::NoError)
+			? std::count(reference.errors.begin(), reference.errors.end(), expected) == std::ptrdiff_t(reference.errors.size())
+			: std::count(reference.errors.begin(), reference.errors.end(), expected) != 0;
+		if (!failed_as_expected)
+		{
+			std::cerr << name << ": the stream backend did not read with error " << int(expected) << "\n";
+			ok = false;
+		}
+		for (const Backend& backend : backends)
+		{
+			for (bool after_open : { false, true })
+			{
+				const std::string label = name + " " + backend.name + (after_open ? " set after open" : " set before open")
+					+ " reading " + std::to_string(max_read_size) + " bytes";
+				Reads reads{};
+				const tiff::Error err = read_file(path, &backend, after_open, max_read_size, reads);
+				if (err == tiff::Error::IoBackendNotSupport)
+				{
+					// nothing to compare on a platform without the backend
+					continue;
+				}
+				if (err != tiff::Error::NoError)
+				{
+					std::cerr << label << ": failed with error " << int(err) << "\n";
+					ok = false;
+					continue;
+				}
+				if (reads.errors != reference.errors)
+				{
+					std::cerr << label << ": the reads did not fail like the stream ones\n";
+					ok = false;
+				}
+				if (reads.samples != reference.samples)
+				{
+					std::cerr << label << ": the samples differ from the stream ones\n";
+					ok = false;
+				}
+			}
+		}
+	}
+	return ok;
+}
+
+int main()
+{
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "tinytiff_cxx_backend.tif";
+	bool ok = true;
+
+	for (const Backend& backend : backends)
+	{
+		tiff::reader::Reader reader{ path };
+		const tiff::Error err = reader.set_io_backend(backend.backend);
+		if (err != tiff::Error::NoError && err != tiff::Error::IoBackendNotSupport)
+		{
+			std::cerr << backend.name << ": choosing the backend failed with error " << int(err) << "\n";
+			ok = false;
+		}
+		else if (err == tiff::Error::IoBackendNotSupport)
+		{
+			std::cout << backend.name << " is not supported here\n";
+		}
+	}
+
+	if (!write_file(path, 0))
+	{
+		std::cerr << "writing the stripped file failed\n";
+		return 1;
+	}
+	ok = compare_backends(path, "strips", tiff::Error::NoError) && ok;
+	if (!write_file(path, 48))
+	{
+		std::cerr << "writing the tiled file failed\n";
+		return 1;
+	}
+	ok = compare_backends(path, "tiles", tiff::Error::NoError) && ok;
+	if (!write_cut_file(path, 301, 97, 8, 301))
+	{
+		std::cerr << "writing the cut file failed\n";
+		return 1;
+	}
+	ok = compare_backends(path, "cut", tiff::Error::StripDataLost) && ok;
+
+	std::error_code ec{};
+	std::filesystem::remove(path, ec);
+	if (ok)
+	{
+		std::cout << "every backend read the same bytes\n";
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,200 @@
+#include "tiff_cxx.h"
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include <type_traits>
+
+// binned reads of every mode against bins worked out here, with partial bins at the right and bottom edges,
+// a small frame checked against values written down by hand, and the errors for a zero factor and a short buffer
+
+template<typename value_t>
+static bool write_file(const std::filesystem::path& path, uint32_t width, uint32_t height, uint16_t samples,
+	const std::vector<value_t>& pixels)
+{
+	tiff::writer::FrameInfo info{};
+	info.width = width;
+	info.height = height;
+	info.bits_per_sample = sizeof(value_t) * 8;
+	info.samples_per_pixel = samples;
+	info.sample_format = std::is_floating_point_v<value_t> ? tiff::SampleFormat::Float
+		: std::is_signed_v<value_t> ? tiff::SampleFormat::Int : tiff::SampleFormat::Uint;
+	info.rows_per_strip = 3;
+
+	tiff::writer::Writer writer{ path };
+	return writer.open() == tiff::Error::NoError && writer.write_frame(info, pixels.data()) == tiff::Error::NoError
+		&& writer.close() == tiff::Error::NoError;
+}
+
+// the bins of one sample as binning defines them, sums in 64 bits and means rounded half away from zero
+template<typename value_t, typename out_t>
+static std::vector<out_t> reference(const std::vector<value_t>& pixels, uint32_t width, uint32_t height, uint16_t samples,
+	uint16_t sample, uint32_t factor, tiff::BinMode mode)
+{
+	const uint32_t across = (width + factor - 1) / factor;
+	const uint32_t down = (height + factor - 1) / factor;
+	std::vector<out_t> bins{};
+	for (uint32_t by = 0; by < down; ++by)
+	{
+		for (uint32_t bx = 0; bx < across; ++bx)
+		{
+			double sum = 0.0;
+			double max = -INFINITY;
+			uint32_t n = 0;
+			for (uint32_t y = by * factor; y < std::min(height, (by + 1) * factor); ++y)
+			{
+				for (uint32_t x = bx * factor; x < std::min(width, (bx + 1) * factor); ++x)
+				{
+					const double v = double(pixels[(size_t(y) * width + x) * samples + sample]);
+					sum += v;
+					max = std::max(max, v);
+					++n;
+				}
+			}
+			const double first = double(pixels[(size_t(by) * factor * width + size_t(bx) * factor) * samples + sample]);
+			switch (mode)
+			{
+			case tiff::BinMode::Sum: bins.emplace_back(out_t(sum)); break;
+			case tiff::BinMode::Max: bins.emplace_back(out_t(max)); break;
+			case tiff::BinMode::Stride: bins.emplace_back(out_t(first)); break;
+			default:
+				bins.emplace_back(out_t(std::is_floating_point_v<value_t> ? sum / n : std::round(sum / n)));
+				break;
+			}
+		}
+	}
+	return bins;
+}
+
+template<typename out_t>
+static bool read_and_compare(tiff::reader::Reader& reader, const std::string& name, uint16_t sample, uint32_t factor,
+	tiff::BinMode mode, const std::vector<out_t>& expected)
+{
+	std::vector<out_t> bins(expected.size());
+	if (reader.read_binned(sample, factor, mode, bins.data(), bins.size() * sizeof(out_t)) != tiff::Error::NoError)
+	{
+		std::cerr << name << ": read_binned failed\n";
+		return false;
+	}
+	for (size_t i = 0; i < bins.size(); ++i)
+	{
+		// float means are divided in the sample type
+		const bool equal = std::is_floating_point_v<out_t> ? std::abs(double(bins[i]) - double(expected[i])) <= 1e-3 * (1.0 + std::abs(double(expected[i])))
+			: bins[i] == expected[i];
+		if (!equal)
+		{
+			std::cerr << name << ": bin " << i << " is " << double(bins[i]) << " instead of " << double(expected[i]) << "\n";
+			return false;
+		}
+	}
+	return true;
+}
+
+template<typename value_t>
+static bool check_type(const std::filesystem::path& path, const std::string& type_name, int64_t bias)
+{
+	typedef std::conditional_t<std::is_floating_point_v<value_t>, double, std::conditional_t<std::is_signed_v<value_t>, int64_t, uint64_t>> sum_t;
+	const uint32_t width = 23;
+	const uint32_t height = 14;
+	const uint16_t samples = 2;
+	std::vector<value_t> pixels(size_t(width) * height * samples);
+	for (size_t i = 0; i < pixels.size(); ++i)
+	{
+		pixels[i] = value_t(int64_t((i * 7919) % 1000) + bias);
+		if constexpr (std::is_floating_point_v<value_t>)
+		{
+			pixels[i] += value_t(0.25);
+		}
+	}
+	if (!write_file(path, width, height, samples, pixels))
+	{
+		std::cerr << type_name << ": writing the file failed\n";
+		return false;
+	}
+	tiff::reader::Reader reader{ path };
+	if (reader.open() != tiff::Error::NoError)
+	{
+		std::cerr << type_name << ": open failed\n";
+		return false;
+	}
+
+	bool ok = true;
+	for (uint32_t factor : { 1u, 4u, 5u, 32u })
+	{
+		for (uint16_t sample = 0; sample < samples; ++sample)
+		{
+			const std::string name = type_name + " factor " + std::to_string(factor) + " sample " + std::to_string(sample);
+			ok = read_and_compare(reader, name + " mean", sample, factor, tiff::BinMode::Mean,
+				reference<value_t, value_t>(pixels, width, height, samples, sample, factor, tiff::BinMode::Mean)) && ok;
+			ok = read_and_compare(reader, name + " sum", sample, factor, tiff::BinMode::Sum,
+				reference<value_t, sum_t>(pixels, width, height, samples, sample, factor, tiff::BinMode::Sum)) && ok;
+			ok = read_and_compare(reader, name + " max", sample, factor, tiff::BinMode::Max,
+				reference<value_t, value_t>(pixels, width, height, samples, sample, factor, tiff::BinMode::Max)) && ok;
+			ok = read_and_compare(reader, name + " stride", sample, factor, tiff::BinMode::Stride,
+				reference<value_t, value_t>(pixels, width, height, samples, sample, factor, tiff::BinMode::Stride)) && ok;
+		}
+	}
+	return ok;
+}
+
+// 5 x 3 pixels in 2 x 2 bins, the last column and row of bins are partial
+static bool check_by_hand(const std::filesystem::path& path)
+{
+	const std::vector<uint16_t> pixels{
+		1, 2, 3, 4, 5,
+		6, 7, 8, 9, 10,
+		11, 12, 13, 14, 15,
+	};
+	if (!write_file(path, 5, 3, 1, pixels))
+	{
+		std::cerr << "writing the small file failed\n";
+		return false;
+	}
+	tiff::reader::Reader reader{ path };
+	if (reader.open() != tiff::Error::NoError)
+	{
+		std::cerr << "opening the small file failed\n";
+		return false;
+	}
+	bool ok = true;
+	ok = read_and_compare<uint64_t>(reader, "by hand sum", 0, 2, tiff::BinMode::Sum, { 16, 24, 15, 23, 27, 15 }) && ok;
+	ok = read_and_compare<uint16_t>(reader, "by hand mean", 0, 2, tiff::BinMode::Mean, { 4, 6, 8, 12, 14, 15 }) && ok;
+	ok = read_and_compare<uint16_t>(reader, "by hand max", 0, 2, tiff::BinMode::Max, { 7, 9, 10, 12, 14, 15 }) && ok;
+	ok = read_and_compare<uint16_t>(reader, "by hand stride", 0, 2, tiff::BinMode::Stride, { 1, 3, 5, 11, 13, 15 }) && ok;
+
+	std::vector<uint64_t> bins(6);
+	if (reader.read_binned(0, 0, tiff::BinMode::Mean, bins.data(), bins.size() * 8) != tiff::Error::InvalidBinFactor)
+	{
+		std::cerr << "a zero bin factor was taken\n";
+		ok = false;
+	}
+	// sums are 64 bit whatever the sample type
+	if (reader.read_binned(0, 2, tiff::BinMode::Sum, bins.data(), bins.size() * 8 - 1) != tiff::Error::BufferTooSmall
+		|| reader.read_binned(0, 2, tiff::BinMode::Max, bins.data(), 6 * 2 - 1) != tiff::Error::BufferTooSmall)
+	{
+		std::cerr << "bins were written into a buffer too small for them\n";
+		ok = false;
+	}
+	return ok;
+}
+
+int main()
+{
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "tinytiff_cxx_bin.tif";
+	bool ok = true;
+	ok = check_by_hand(path) && ok;
+	ok = check_type<uint16_t>(path, "uint16", 0) && ok;
+	ok = check_type<int16_t>(path, "int16", -500) && ok;
+	ok = check_type<uint8_t>(path, "uint8", -800) && ok;
+	ok = check_type<float>(path, "float", -500) && ok;
+	std::error_code ec{};
+	std::filesystem::remove(path, ec);
+	if (ok)
+	{
+		std::cout << "binned reads match\n";
+	}
+	return ok ? 0 : 1;
+}
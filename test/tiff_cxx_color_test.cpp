@@ -0,0 +1,356 @@
+#include "tiff_cxx.h"
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+
+// YCbCr (subsampled too), CMYK, WhiteIsZero and palette files built in memory are read with color conversion
+// (and palette expansion) and compared to red, green and blue worked out here from the stored samples
+
+struct Entry
+{
+	uint16_t tag;
+	uint16_t type;
+	std::vector<uint32_t> values;
+};
+
+// a little endian TIFF of one strip, the entries in tag order. the layout is worked out first and the file
+// sized once, then written at explicit offsets
+static std::vector<uint8_t> build_tiff(const std::vector<uint8_t>& strip, std::vector<Entry> entries)
+{
+	const uint32_t strip_at = 8;
+	entries.push_back({ 273, 4, { strip_at } });
+	entries.push_back({ 279, 4, { uint32_t(strip.size()) } });
+	std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.tag < b.tag; });
+
+	// values which do not fit the entry go between the strip and the IFD
+	std::vector<size_t> value_at(entries.size(), 0);
+	size_t end = strip_at + strip.size();
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		const size_t bytes = entries[i].values.size() * (entries[i].type == 3 ? 2 : 4);
+		if (bytes > 4)
+		{
+			value_at[i] = end;
+			end += bytes;
+		}
+	}
+	const size_t ifd = end;
+	std::vector<uint8_t> file(ifd + 2 + entries.size() * 12 + 4, 0);
+
+	uint8_t* data = file.data();
+	auto put = [data](uint64_t value, uint32_t bytes, size_t at)
+	{
+		for (uint32_t b = 0; b < bytes; ++b)
+		{
+			data[at + b] = uint8_t(value >> (b * 8));
+		}
+	};
+	data[0] = data[1] = 'I';
+	put(42, 2, 2);
+	put(ifd, 4, 4);
+	std::copy(strip.begin(), strip.end(), data + strip_at);
+
+	put(entries.size(), 2, ifd);
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		const size_t at = ifd + 2 + i * 12;
+		const uint32_t size = entries[i].type == 3 ? 2 : 4;
+		put(entries[i].tag, 2, at);
+		put(entries[i].type, 2, at + 2);
+		put(entries[i].values.size(), 4, at + 4);
+		const size_t values_at = value_at[i] != 0 ? value_at[i] : at + 8;
+		if (value_at[i] != 0)
+		{
+			put(value_at[i], 4, at + 8);
+		}
+		for (size_t v = 0; v < entries[i].values.size(); ++v)
+		{
+			put(entries[i].values[v], size, values_at + v * size);
+		}
+	}
+	return file;
+}
+
+static std::vector<Entry> base_entries(uint32_t width, uint32_t height, uint16_t bits, uint16_t samples, uint16_t photometric)
+{
+	return {
+		{ 256, 4, { width } },
+		{ 257, 4, { height } },
+		{ 258, 3, std::vector<uint32_t>(samples, bits) },
+		{ 259, 3, { 1 } },
+		{ 262, 3, { photometric } },
+		{ 277, 3, { samples } },
+		{ 278, 4, { height } },
+		{ 284, 3, { 1 } },
+	};
+}
+
+// reads every channel of the converted image, channel after channel
+static bool read_channels(const std::vector<uint8_t>& file, uint16_t channels, uint32_t bytes, std::vector<uint32_t>& out)
+{
+	tiff::reader::Reader reader{ file.data(), file.size() };
+	reader.set_convert_color(true);
+	reader.set_expand_palette(true);
+	if (reader.open() != tiff::Error::NoError)
+	{
+		return false;
+	}
+	const uint32_t width = reader.width();
+	const uint32_t height = reader.height();
+	const size_t pixels = size_t(width) * height;
+	std::vector<uint8_t> buffer(pixels * bytes);
+	out.assign(pixels * channels, 0);
+	for (uint16_t c = 0; c < channels; ++c)
+	{
+		if (reader.read_region(0, c, tiff::Rect{ 0, 0, width, height }, buffer.data(), buffer.size()) != tiff::Error::NoError)
+		{
+			return false;
+		}
+		for (size_t p = 0; p < pixels; ++p)
+		{
+			out[c * pixels + p] = bytes == 1 ? buffer[p] : uint32_t(buffer[p * 2] | (buffer[p * 2 + 1] << 8));
+		}
+	}
+	return true;
+}
+
+static bool compare(const std::string& name, const std::vector<uint32_t>& got, const std::vector<double>& expected, double tolerance)
+{
+	for (size_t i = 0; i < got.size(); ++i)
+	{
+		if (std::abs(double(got[i]) - expected[i]) > tolerance)
+		{
+			std::cerr << name << ": sample " << i << " is " << got[i] << " instead of " << expected[i] << "\n";
+			return false;
+		}
+	}
+	return true;
+}
+
+static double clamp_round(double v, double max)
+{
+	return std::floor(std::min(std::max(v, 0.0), max) + 0.5);
+}
+
+// 8 bit YCbCr in units of h x v lumas followed by Cb and Cr
+static bool check_ycbcr(uint32_t h, uint32_t v)
+{
+	const uint32_t width = 12;
+	const uint32_t height = 8;
+	const uint32_t units_x = width / h;
+	const uint32_t units_y = height / v;
+	auto luma = [](uint32_t x, uint32_t y) { return uint8_t(16 + (x * 19 + y * 23) % 220); };
+	auto cb = [](uint32_t ux, uint32_t uy) { return uint8_t(40 + (ux * 37 + uy * 11) % 180); };
+	auto cr = [](uint32_t ux, uint32_t uy) { return uint8_t(200 - (ux * 13 + uy * 29) % 170); };
+
+	std::vector<uint8_t> strip{};
+	for (uint32_t uy = 0; uy < units_y; ++uy)
+	{
+		for (uint32_t ux = 0; ux < units_x; ++ux)
+		{
+			for (uint32_t j = 0; j < v; ++j)
+			{
+				for (uint32_t i = 0; i < h; ++i)
+				{
+					strip.emplace_back(luma(ux * h + i, uy * v + j));
+				}
+			}
+			strip.emplace_back(cb(ux, uy));
+			strip.emplace_back(cr(ux, uy));
+		}
+	}
+	std::vector<Entry> entries = base_entries(width, height, 8, 3, 6);
+	entries.push_back({ 530, 3, { h, v } });
+
+	std::vector<double> expected(size_t(width) * height * 3);
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			const double l = luma(x, y);
+			const double b = cb(x / h, y / v) - 128.0;
+			const double r = cr(x / h, y / v) - 128.0;
+			const size_t p = size_t(y) * width + x;
+			expected[p] = clamp_round(l + 1.402 * r, 255.0);
+			expected[width * height + p] = clamp_round(l - 0.344136 * b - 0.714136 * r, 255.0);
+			expected[2 * width * height + p] = clamp_round(l + 1.772 * b, 255.0);
+		}
+	}
+
+	const std::string name = "YCbCr " + std::to_string(h) + "x" + std::to_string(v);
+	std::vector<uint32_t> got{};
+	if (!read_channels(build_tiff(strip, entries), 3, 1, got))
+	{
+		std::cerr << name << ": read failed\n";
+		return false;
+	}
+	return compare(name, got, expected, 1.0);
+}
+
+// CMYK with one extra sample after the black, which reads as the fourth channel
+static bool check_cmyk(uint16_t bits)
+{
+	const uint32_t width = 9;
+	const uint32_t height = 7;
+	const uint32_t bytes = bits / 8;
+	const double max = double((1u << bits) - 1);
+	auto value = [bits](uint32_t x, uint32_t y, uint32_t c) { return uint32_t((x * 977 + y * 1531 + c * 4099) % (1u << bits)); };
+
+	std::vector<uint8_t> strip{};
+	std::vector<double> expected(size_t(width) * height * 4);
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			for (uint32_t c = 0; c < 5; ++c)
+			{
+				for (uint32_t b = 0; b < bytes; ++b)
+				{
+					strip.emplace_back(uint8_t(value(x, y, c) >> (b * 8)));
+				}
+			}
+			const size_t p = size_t(y) * width + x;
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				expected[c * width * height + p] = std::floor((max - value(x, y, c)) * (max - value(x, y, 3)) / max + 0.5);
+			}
+			expected[3 * width * height + p] = value(x, y, 4);
+		}
+	}
+	std::vector<Entry> entries = base_entries(width, height, bits, 5, 5);
+	entries.push_back({ 338, 3, { 0 } });
+
+	const std::string name = "CMYK " + std::to_string(bits) + " bit";
+	std::vector<uint32_t> got{};
+	if (!read_channels(build_tiff(strip, entries), 4, bytes, got))
+	{
+		std::cerr << name << ": read failed\n";
+		return false;
+	}
+	return compare(name, got, expected, 1.0);
+}
+
+static bool check_white_is_zero(uint16_t bits)
+{
+	const uint32_t width = 11;
+	const uint32_t height = 5;
+	const uint32_t bytes = bits / 8;
+	std::vector<uint8_t> strip{};
+	std::vector<double> expected{};
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			const uint32_t v = (x * 2749 + y * 4111) % (1u << bits);
+			for (uint32_t b = 0; b < bytes; ++b)
+			{
+				strip.emplace_back(uint8_t(v >> (b * 8)));
+			}
+			expected.emplace_back(double((1u << bits) - 1 - v));
+		}
+	}
+
+	const std::string name = "WhiteIsZero " + std::to_string(bits) + " bit";
+	std::vector<uint32_t> got{};
+	if (!read_channels(build_tiff(strip, base_entries(width, height, bits, 1, 0)), 1, bytes, got))
+	{
+		std::cerr << name << ": read failed\n";
+		return false;
+	}
+	return compare(name, got, expected, 0.0);
+}
+
+// 4 or 8 bit indices into a color map, which reads as three 16 bit channels. a map short of one color is refused
+static bool check_palette(uint16_t bits)
+{
+	const uint32_t width = 9;
+	const uint32_t height = 6;
+	const uint32_t colors = 1u << bits;
+	auto index = [colors](uint32_t x, uint32_t y) { return (x * 7 + y * 5) % colors; };
+	auto color = [](uint32_t c, uint32_t i) { return uint32_t((i * 2851 + c * 21011 + 97) % 65536); };
+
+	// rows start on a byte, 4 bit indices are packed high nibble first
+	std::vector<uint8_t> strip{};
+	std::vector<double> expected(size_t(width) * height * 3);
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			if (bits == 8)
+			{
+				strip.emplace_back(uint8_t(index(x, y)));
+			}
+			else if (x % 2 == 0)
+			{
+				strip.emplace_back(uint8_t(index(x, y) << 4));
+			}
+			else
+			{
+				strip.back() |= uint8_t(index(x, y));
+			}
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				expected[c * width * height + size_t(y) * width + x] = color(c, index(x, y));
+			}
+		}
+	}
+	std::vector<uint32_t> map{};
+	for (uint32_t c = 0; c < 3; ++c)
+	{
+		for (uint32_t i = 0; i < colors; ++i)
+		{
+			map.emplace_back(color(c, i));
+		}
+	}
+	std::vector<Entry> entries = base_entries(width, height, bits, 1, 3);
+	entries.push_back({ 320, 3, map });
+
+	const std::string name = "palette " + std::to_string(bits) + " bit";
+	std::vector<uint32_t> got{};
+	if (!read_channels(build_tiff(strip, entries), 3, 2, got))
+	{
+		std::cerr << name << ": read failed\n";
+		return false;
+	}
+	if (!compare(name, got, expected, 0.0))
+	{
+		return false;
+	}
+
+	entries.back().values.resize(map.size() - 3);
+	const std::vector<uint8_t> file = build_tiff(strip, entries);
+	tiff::reader::Reader reader{ file.data(), file.size() };
+	reader.set_expand_palette(true);
+	std::vector<uint16_t> buffer(size_t(width) * height);
+	const tiff::Error open_err = reader.open();
+	if (open_err != tiff::Error::InvalidColorMap
+		&& reader.read_region(0, 0, tiff::Rect{ 0, 0, width, height }, buffer.data(), buffer.size() * 2) != tiff::Error::InvalidColorMap)
+	{
+		std::cerr << name << ": a color map short of one color was taken\n";
+		return false;
+	}
+	return true;
+}
+
+int main()
+{
+	bool ok = true;
+	for (const auto& unit : { std::pair<uint32_t, uint32_t>{ 1, 1 }, { 2, 1 }, { 2, 2 }, { 4, 2 }, { 4, 4 } })
+	{
+		ok = check_ycbcr(unit.first, unit.second) && ok;
+	}
+	ok = check_cmyk(8) && ok;
+	ok = check_cmyk(16) && ok;
+	ok = check_white_is_zero(8) && ok;
+	ok = check_white_is_zero(16) && ok;
+	ok = check_palette(8) && ok;
+	ok = check_palette(4) && ok;
+	if (ok)
+	{
+		std::cout << "converted colors match\n";
+	}
+	return ok ? 0 : 1;
+}
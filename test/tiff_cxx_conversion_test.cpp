@@ -0,0 +1,162 @@
+#include "tiff_cxx.h"
+
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <filesystem>
+#include <type_traits>
+
+// samples at the limits of every output type (below the lowest value, above the highest, halves to be rounded,
+// NaN and infinities) are read through set_conversion and compared to the rounded and saturated values worked out here
+
+static const float nan_value = std::numeric_limits<float>::quiet_NaN();
+static const float infinity = std::numeric_limits<float>::infinity();
+
+// integers round half away from zero and saturate, NaN gives 0
+template<typename out_t>
+static out_t expected_value(double v)
+{
+	if constexpr (std::is_floating_point_v<out_t>)
+	{
+		return out_t(v);
+	}
+	else
+	{
+		if (v != v)
+		{
+			return out_t(0);
+		}
+		if (v >= double(std::numeric_limits<out_t>::max()))
+		{
+			return std::numeric_limits<out_t>::max();
+		}
+		if (v <= double(std::numeric_limits<out_t>::lowest()))
+		{
+			return std::numeric_limits<out_t>::lowest();
+		}
+		return out_t(v < 0 ? v - 0.5 : v + 0.5);
+	}
+}
+
+template<typename in_t>
+static bool write_file(const std::filesystem::path& path, const std::vector<in_t>& samples)
+{
+	tiff::writer::FrameInfo info{};
+	info.width = uint32_t(samples.size());
+	info.height = 1;
+	info.bits_per_sample = sizeof(in_t) * 8;
+	info.samples_per_pixel = 1;
+	info.sample_format = std::is_floating_point_v<in_t> ? tiff::SampleFormat::Float
+		: std::is_signed_v<in_t> ? tiff::SampleFormat::Int : tiff::SampleFormat::Uint;
+	info.rows_per_strip = 1;
+
+	tiff::writer::Writer writer{ path };
+	return writer.open() == tiff::Error::NoError && writer.write_frame(info, samples.data()) == tiff::Error::NoError
+		&& writer.close() == tiff::Error::NoError;
+}
+
+template<typename in_t, typename out_t>
+static bool check_output(const std::filesystem::path& path, const std::string& name, const std::vector<in_t>& samples,
+	double scale, double offset)
+{
+	tiff::reader::Conversion conversion{};
+	conversion.bits_per_sample = sizeof(out_t) * 8;
+	conversion.sample_format = std::is_floating_point_v<out_t> ? tiff::SampleFormat::Float
+		: std::is_signed_v<out_t> ? tiff::SampleFormat::Int : tiff::SampleFormat::Uint;
+	conversion.scale = scale;
+	conversion.offset = offset;
+
+	tiff::reader::Reader reader{ path };
+	if (reader.set_conversion(conversion) != tiff::Error::NoError || reader.open() != tiff::Error::NoError)
+	{
+		std::cerr << name << ": open failed\n";
+		return false;
+	}
+	const uint32_t width = uint32_t(samples.size());
+	std::vector<out_t> buffer(width);
+	if (reader.read_region(0, 0, tiff::Rect{ 0, 0, width, 1 }, buffer.data(), buffer.size() * sizeof(out_t)) != tiff::Error::NoError)
+	{
+		std::cerr << name << ": read_region failed\n";
+		return false;
+	}
+	for (uint32_t i = 0; i < width; ++i)
+	{
+		const double v = double(samples[i]) * scale + offset;
+		const out_t expected = expected_value<out_t>(v);
+		const bool both_nan = std::is_floating_point_v<out_t> && buffer[i] != buffer[i] && expected != expected;
+		if (!both_nan && buffer[i] != expected)
+		{
+			std::cerr << name << ": " << v << " became " << double(buffer[i]) << " instead of " << double(expected) << "\n";
+			return false;
+		}
+	}
+	return true;
+}
+
+template<typename in_t>
+static bool check_input(const std::filesystem::path& path, const std::string& name, const std::vector<in_t>& samples,
+	double scale, double offset)
+{
+	if (!write_file(path, samples))
+	{
+		std::cerr << name << ": writing the file failed\n";
+		return false;
+	}
+	bool ok = true;
+	ok = check_output<in_t, uint8_t>(path, name + " to uint8", samples, scale, offset) && ok;
+	ok = check_output<in_t, int8_t>(path, name + " to int8", samples, scale, offset) && ok;
+	ok = check_output<in_t, uint16_t>(path, name + " to uint16", samples, scale, offset) && ok;
+	ok = check_output<in_t, int16_t>(path, name + " to int16", samples, scale, offset) && ok;
+	ok = check_output<in_t, uint32_t>(path, name + " to uint32", samples, scale, offset) && ok;
+	ok = check_output<in_t, int32_t>(path, name + " to int32", samples, scale, offset) && ok;
+	ok = check_output<in_t, uint64_t>(path, name + " to uint64", samples, scale, offset) && ok;
+	ok = check_output<in_t, int64_t>(path, name + " to int64", samples, scale, offset) && ok;
+	ok = check_output<in_t, float>(path, name + " to float", samples, scale, offset) && ok;
+	ok = check_output<in_t, double>(path, name + " to double", samples, scale, offset) && ok;
+	return ok;
+}
+
+int main()
+{
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "tinytiff_cxx_conversion.tif";
+	bool ok = true;
+
+	// halves next to and on the limits of every integer type, and values far outside all of them
+	const std::vector<float> floats{
+		0.0f, -0.0f, 0.49f, 0.5f, -0.5f, 1.5f, -1.5f, 2.5f, -2.5f,
+		-128.5f, -128.49f, -127.5f, 126.5f, 127.49f, 127.5f,
+		254.5f, 255.49f, 255.5f, 256.0f,
+		-32768.5f, -32767.5f, 32766.5f, 32767.5f, 65534.5f, 65535.5f,
+		-2147483648.0f, 2147483648.0f, 4294967296.0f, -1e12f, 1e12f, 1e20f, -1e20f,
+		nan_value, infinity, -infinity,
+	};
+	ok = check_input(path, "float", floats, 1.0, 0.0) && ok;
+	ok = check_input(path, "float scaled", floats, -2.0, 0.5) && ok;
+
+	// integers going through the float path, halves made by the scale
+	std::vector<uint16_t> unsigned_samples{};
+	for (uint32_t v : { 0u, 1u, 3u, 5u, 253u, 255u, 256u, 509u, 511u, 512u, 65533u, 65535u })
+	{
+		unsigned_samples.emplace_back(uint16_t(v));
+	}
+	ok = check_input(path, "uint16 halved", unsigned_samples, 0.5, 0.0) && ok;
+	ok = check_input(path, "uint16 shifted", unsigned_samples, 1.0, -255.5) && ok;
+
+	std::vector<int16_t> signed_samples{};
+	for (int32_t v : { -32768, -32767, -257, -255, -5, -3, -1, 0, 1, 3, 5, 255, 257, 32767 })
+	{
+		signed_samples.emplace_back(int16_t(v));
+	}
+	ok = check_input(path, "int16 halved", signed_samples, 0.5, 0.0) && ok;
+	ok = check_input(path, "int16 scaled up", signed_samples, 1000.5, 0.25) && ok;
+
+	std::error_code ec{};
+	std::filesystem::remove(path, ec);
+	if (ok)
+	{
+		std::cout << "conversions round and saturate\n";
+	}
+	return ok ? 0 : 1;
+}
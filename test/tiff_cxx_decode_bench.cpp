@@ -0,0 +1,244 @@
+﻿#include "tiff_cxx.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+
+// decode throughput for the sample layouts the reader has kernels for: depth, samples per pixel,
+// chunky or planar and byte order. the files are built in memory so the numbers are decoding only
+
+struct Layout
+{
+	uint16_t bits = 8;
+	uint16_t samples = 1;
+	bool planar = false;
+	bool big_endian = false;
+};
+
+static uint64_t sample_value(uint32_t x, uint32_t y, uint32_t c, uint16_t bits)
+{
+	const uint64_t v = uint64_t(x) * 31 + uint64_t(y) * 17 + c * 7;
+	return bits == 64 ? v : v & ((uint64_t(1) << bits) - 1);
+}
+
+// packs one row of samples, whole bytes in the file byte order and other depths as a bit stream
+static void put_row(std::vector<uint8_t>& out, const std::vector<uint64_t>& values, const Layout& layout)
+{
+	if (layout.bits % 8 == 0)
+	{
+		const uint32_t bytes = layout.bits / 8;
+		for (uint64_t v : values)
+		{
+			for (uint32_t b = 0; b < bytes; ++b)
+			{
+				const uint32_t shift = layout.big_endian ? (bytes - 1 - b) * 8 : b * 8;
+				out.emplace_back(uint8_t(v >> shift));
+			}
+		}
+		return;
+	}
+	uint64_t acc = 0;
+	uint32_t held = 0;
+	for (uint64_t v : values)
+	{
+		acc = (acc << layout.bits) | v;
+		held += layout.bits;
+		while (held >= 8)
+		{
+			held -= 8;
+			out.emplace_back(uint8_t(acc >> held));
+		}
+	}
+	if (held != 0)
+	{
+		out.emplace_back(uint8_t(acc << (8 - held)));
+	}
+}
+
+static std::vector<uint8_t> build_tiff(uint32_t width, uint32_t height, const Layout& layout)
+{
+	const uint32_t rows_per_strip = 64;
+	const uint32_t strips_per_plane = (height + rows_per_strip - 1) / rows_per_strip;
+	const uint32_t planes = layout.planar ? layout.samples : 1;
+
+	std::vector<uint8_t> file(8, 0);
+	std::vector<uint32_t> offsets{};
+	std::vector<uint32_t> counts{};
+	std::vector<uint64_t> values{};
+	for (uint32_t plane = 0; plane < planes; ++plane)
+	{
+		for (uint32_t strip = 0; strip < strips_per_plane; ++strip)
+		{
+			offsets.emplace_back(uint32_t(file.size()));
+			for (uint32_t y = strip * rows_per_strip; y < std::min(height, (strip + 1) * rows_per_strip); ++y)
+			{
+				values.clear();
+				for (uint32_t x = 0; x < width; ++x)
+				{
+					for (uint32_t c = 0; c < layout.samples; ++c)
+					{
+						if (!layout.planar || c == plane)
+						{
+							values.emplace_back(sample_value(x, y, c, layout.bits));
+						}
+					}
+				}
+				put_row(file, values, layout);
+			}
+			counts.emplace_back(uint32_t(file.size()) - offsets.back());
+		}
+	}
+
+	auto put = [&](uint64_t value, uint32_t bytes, size_t at)
+	{
+		for (uint32_t b = 0; b < bytes; ++b)
+		{
+			const uint32_t shift = layout.big_endian ? (bytes - 1 - b) * 8 : b * 8;
+			file[at + b] = uint8_t(value >> shift);
+		}
+	};
+	auto append_array = [&](const std::vector<uint32_t>& array)
+	{
+		const size_t at = file.size();
+		file.resize(at + array.size() * 4);
+		for (size_t i = 0; i < array.size(); ++i)
+		{
+			put(array[i], 4, at + i * 4);
+		}
+		return uint32_t(at);
+	};
+	const uint32_t offsets_at = append_array(offsets);
+	const uint32_t counts_at = append_array(counts);
+	const uint32_t bits_at = append_array(std::vector<uint32_t>(2, uint32_t(layout.bits) * 0x10001u));
+
+	struct Entry
+	{
+		uint16_t tag;
+		uint16_t type;
+		uint32_t count;
+		uint32_t value;
+	};
+	const std::vector<Entry> entries{
+		{ 256, 4, 1, width },
+		{ 257, 4, 1, height },
+		{ 258, 3, layout.samples, layout.samples == 1 ? uint32_t(layout.bits) : bits_at },
+		{ 259, 3, 1, 1 },
+		{ 262, 3, 1, layout.samples == 3 ? 2u : 1u },
+		{ 273, 4, uint32_t(offsets.size()), offsets_at },
+		{ 277, 3, 1, layout.samples },
+		{ 278, 4, 1, rows_per_strip },
+		{ 279, 4, uint32_t(counts.size()), counts_at },
+		{ 284, 3, 1, layout.planar ? 2u : 1u },
+	};
+
+	const size_t ifd = file.size();
+	file.resize(ifd + 2 + entries.size() * 12 + 4, 0);
+	put(entries.size(), 2, ifd);
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		const size_t at = ifd + 2 + i * 12;
+		const auto& entry = entries[i];
+		put(entry.tag, 2, at);
+		put(entry.type, 2, at + 2);
+		put(entry.count, 4, at + 4);
+		// single shorts sit in the first two bytes of the value field
+		if (entry.type == 3 && entry.count == 1)
+		{
+			put(entry.value, 2, at + 8);
+		}
+		else
+		{
+			put(entry.value, 4, at + 8);
+		}
+	}
+
+	file[0] = file[1] = layout.big_endian ? 'M' : 'I';
+	put(42, 2, 2);
+	put(ifd, 4, 4);
+	return file;
+}
+
+int main()
+{
+	const uint32_t width = 1024;
+	const uint32_t height = 1024;
+	const int runs = 15;
+
+	std::vector<Layout> layouts{};
+	for (uint16_t bits : { 8, 16, 32, 64, 1, 12 })
+	{
+		for (uint16_t samples : { 1, 3 })
+		{
+			for (bool planar : { false, true })
+			{
+				for (bool big_endian : { false, true })
+				{
+					if ((planar && samples == 1) || (big_endian && bits % 8 != 0) || (big_endian && bits == 8))
+					{
+						continue;
+					}
+					layouts.emplace_back(Layout{ bits, samples, planar, big_endian });
+				}
+			}
+		}
+	}
+
+	std::cout << "bits spp layout  order   ns/sample    MB/s\n";
+	for (const auto& layout : layouts)
+	{
+		const std::vector<uint8_t> file = build_tiff(width, height, layout);
+		tiff::reader::Reader reader{ file.data(), file.size() };
+		if (reader.open() != tiff::Error::NoError)
+		{
+			std::cerr << "open failed\n";
+			return 1;
+		}
+		const uint32_t out_bytes = layout.bits <= 8 ? 1 : layout.bits <= 16 ? 2 : layout.bits <= 32 ? 4 : 8;
+		std::vector<uint8_t> buffer(size_t(width) * height * out_bytes);
+
+		std::vector<double> times{};
+		for (int i = 0; i < runs; ++i)
+		{
+			auto begin = std::chrono::steady_clock::now();
+			for (uint16_t c = 0; c < layout.samples; ++c)
+			{
+				if (reader.read_region(0, c, tiff::Rect{ 0, 0, width, height }, buffer.data(), buffer.size()) != tiff::Error::NoError)
+				{
+					std::cerr << "read failed\n";
+					return 1;
+				}
+			}
+			auto end = std::chrono::steady_clock::now();
+			times.emplace_back(std::chrono::duration<double, std::nano>(end - begin).count());
+		}
+		std::sort(times.begin(), times.end());
+
+		// the last sample plane read is still in the buffer
+		const uint32_t c = layout.samples - 1;
+		for (uint32_t y = 0; y < height; y += 97)
+		{
+			for (uint32_t x = 0; x < width; x += 13)
+			{
+				uint64_t v = 0;
+				std::memcpy(&v, &buffer[(size_t(y) * width + x) * out_bytes], out_bytes);
+				if (v != sample_value(x, y, c, layout.bits))
+				{
+					std::cerr << "wrong sample at " << x << ", " << y << "\n";
+					return 1;
+				}
+			}
+		}
+
+		const double samples = double(width) * height * layout.samples;
+		const double ns = times[times.size() / 2];
+		std::cout << std::setw(4) << layout.bits << std::setw(4) << layout.samples
+			<< (layout.planar ? "  planar " : "  chunky ") << (layout.big_endian ? " big   " : " little")
+			<< std::fixed << std::setprecision(3) << std::setw(12) << ns / samples
+			<< std::setprecision(0) << std::setw(9) << samples * out_bytes / ns * 1000.0 << "\n";
+	}
+	return 0;
+}
\ No newline at end of file
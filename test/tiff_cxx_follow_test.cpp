@@ -0,0 +1,134 @@
+#include "tiff_cxx.h"
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <filesystem>
+
+// follow mode against a file still being written: frames show up once the writer links them,
+// a frame whose rows are only partly written does not
+
+static uint16_t sample_value(uint32_t x, uint32_t y, uint32_t frame)
+{
+	return uint16_t(x * 31 + y * 17 + frame * 1001);
+}
+
+static std::vector<uint16_t> make_frame(uint32_t width, uint32_t height, uint32_t frame)
+{
+	std::vector<uint16_t> pixels(size_t(width) * height);
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			pixels[size_t(y) * width + x] = sample_value(x, y, frame);
+		}
+	}
+	return pixels;
+}
+
+static bool check_frame(tiff::reader::Reader& reader, uint32_t frame)
+{
+	const uint32_t width = reader.width();
+	const uint32_t height = reader.height();
+	std::vector<uint16_t> buffer(size_t(width) * height);
+	if (reader.read_region(0, 0, tiff::Rect{ 0, 0, width, height }, buffer.data(), buffer.size() * 2) != tiff::Error::NoError)
+	{
+		std::cerr << "read_region failed on frame " << frame << "\n";
+		return false;
+	}
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			if (buffer[size_t(y) * width + x] != sample_value(x, y, frame))
+			{
+				std::cerr << "frame " << frame << " is wrong at " << x << ", " << y << "\n";
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static bool run(const std::filesystem::path& path)
+{
+	const uint32_t frames = 4;
+	tiff::writer::FrameInfo info{};
+	info.width = 67;
+	info.height = 45;
+	info.bits_per_sample = 16;
+	info.rows_per_strip = 8;
+
+	tiff::writer::Writer writer{ path };
+	if (writer.open() != tiff::Error::NoError
+		|| writer.write_frame(info, make_frame(info.width, info.height, 0).data()) != tiff::Error::NoError)
+	{
+		std::cerr << "writing the first frame failed\n";
+		return false;
+	}
+
+	tiff::reader::Reader reader{ path };
+	reader.set_follow(true);
+	if (reader.open() != tiff::Error::NoError || !check_frame(reader, 0))
+	{
+		std::cerr << "the first frame did not read\n";
+		return false;
+	}
+	if (reader.count_frames() != 1 || reader.has_next_frame() || reader.wait_for_next_frame(20))
+	{
+		std::cerr << "a frame shows up before it was written\n";
+		return false;
+	}
+
+	for (uint32_t frame = 1; frame < frames; ++frame)
+	{
+		const std::vector<uint16_t> pixels = make_frame(info.width, info.height, frame);
+		const uint32_t half = info.height / 2;
+		if (writer.begin_frame(info) != tiff::Error::NoError || writer.write_rows(pixels.data(), half) != tiff::Error::NoError)
+		{
+			std::cerr << "writing the first rows of frame " << frame << " failed\n";
+			return false;
+		}
+		if (reader.wait_for_next_frame(20) || reader.count_frames() != frame)
+		{
+			std::cerr << "frame " << frame << " shows up before it was linked\n";
+			return false;
+		}
+		if (writer.write_rows(&pixels[size_t(half) * info.width], info.height - half) != tiff::Error::NoError
+			|| writer.end_frame() != tiff::Error::NoError)
+		{
+			std::cerr << "writing the last rows of frame " << frame << " failed\n";
+			return false;
+		}
+		if (!reader.wait_for_next_frame(1000) || reader.read_next_frame() != tiff::Error::NoError || !check_frame(reader, frame))
+		{
+			std::cerr << "frame " << frame << " did not show up\n";
+			return false;
+		}
+		if (reader.count_frames() != frame + 1)
+		{
+			std::cerr << reader.count_frames() << " frames counted after frame " << frame << "\n";
+			return false;
+		}
+	}
+
+	if (writer.close() != tiff::Error::NoError || reader.has_next_frame())
+	{
+		std::cerr << "the file did not end after the last frame\n";
+		return false;
+	}
+	return true;
+}
+
+int main()
+{
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "tinytiff_cxx_follow.tif";
+	const bool ok = run(path);
+	std::error_code ec{};
+	std::filesystem::remove(path, ec);
+	if (ok)
+	{
+		std::cout << "followed frames read back\n";
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,175 @@
+#include "tiff_cxx.h"
+
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <iostream>
+
+// every one of the 65536 halves (zeros, subnormals, the largest finite value, infinities and NaNs among them)
+// is read as float and compared bit for bit to the value worked out here. the test is also built with
+// TIFF_CXX_HAS_F16C=0, so the portable conversion and F16C are held to the same values
+
+static const uint32_t width = 256;
+static const uint32_t height = 256;
+
+// the float a half stands for, NaNs quiet with their payload kept
+static uint32_t expected_bits(uint16_t h)
+{
+	const bool negative = (h & 0x8000) != 0;
+	const int exponent = (h >> 10) & 0x1F;
+	const uint32_t mantissa = h & 0x3FF;
+	float value = 0.0f;
+	if (exponent == 0x1F && mantissa != 0)
+	{
+		const uint32_t bits = (negative ? 0x80000000u : 0u) | 0x7FC00000u | (mantissa << 13);
+		return bits;
+	}
+	if (exponent == 0x1F)
+	{
+		value = std::numeric_limits<float>::infinity();
+	}
+	else if (exponent == 0)
+	{
+		value = std::ldexp(float(mantissa), -24);
+	}
+	else
+	{
+		value = std::ldexp(float(1024 + mantissa), exponent - 25);
+	}
+	value = negative ? -value : value;
+	uint32_t bits = 0;
+	std::memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+// one strip of little endian halves, each short entry in the first two bytes of its value
+static std::vector<uint8_t> build_tiff()
+{
+	const uint32_t entries = 10;
+	const uint32_t strip_at = 8 + 2 + entries * 12 + 4;
+	std::vector<uint8_t> file(strip_at + size_t(width) * height * 2, 0);
+	auto put = [&file](uint64_t value, uint32_t bytes, size_t at)
+	{
+		for (uint32_t b = 0; b < bytes; ++b)
+		{
+			file[at + b] = uint8_t(value >> (b * 8));
+		}
+	};
+	file[0] = file[1] = 'I';
+	put(42, 2, 2);
+	put(8, 4, 4);
+
+	const uint32_t values[entries][4]{
+		{ 256, 4, 1, width },
+		{ 257, 4, 1, height },
+		{ 258, 3, 1, 16 },
+		{ 259, 3, 1, 1 },
+		{ 262, 3, 1, 1 },
+		{ 273, 4, 1, strip_at },
+		{ 277, 3, 1, 1 },
+		{ 278, 4, 1, height },
+		{ 279, 4, 1, width * height * 2 },
+		{ 339, 3, 1, 3 },
+	};
+	put(entries, 2, 8);
+	for (uint32_t i = 0; i < entries; ++i)
+	{
+		const size_t at = 8 + 2 + i * 12;
+		put(values[i][0], 2, at);
+		put(values[i][1], 2, at + 2);
+		put(values[i][2], 4, at + 4);
+		put(values[i][3], values[i][1] == 3 ? 2 : 4, at + 8);
+	}
+	for (uint32_t h = 0; h < width * height; ++h)
+	{
+		put(h, 2, strip_at + size_t(h) * 2);
+	}
+	return file;
+}
+
+// rows whose length is not a multiple of 8 also go through the tail after the 8 wide F16C conversion
+static bool check_region(tiff::reader::Reader& reader, const tiff::Rect& region)
+{
+	std::vector<float> buffer(size_t(region.width) * region.height);
+	if (reader.read_region(0, 0, region, buffer.data(), buffer.size() * sizeof(float)) != tiff::Error::NoError)
+	{
+		std::cerr << "reading halves as float failed\n";
+		return false;
+	}
+	for (uint32_t y = 0; y < region.height; ++y)
+	{
+		for (uint32_t x = 0; x < region.width; ++x)
+		{
+			const uint16_t h = uint16_t((region.y + y) * width + region.x + x);
+			uint32_t bits = 0;
+			std::memcpy(&bits, &buffer[size_t(y) * region.width + x], sizeof(bits));
+			if (bits != expected_bits(h))
+			{
+				std::cerr << "half " << std::hex << h << " is float " << bits << " instead of " << expected_bits(h) << std::dec << "\n";
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+int main()
+{
+	// the values worked out here hold for the cases with a name
+	const std::pair<uint16_t, float> named[]{
+		{ 0x0000, 0.0f },
+		{ 0x8000, -0.0f },
+		{ 0x0001, 5.9604645e-8f },  // smallest subnormal
+		{ 0x03FF, 6.0975552e-5f },  // largest subnormal
+		{ 0x0400, 6.1035156e-5f },  // smallest normal
+		{ 0x3C00, 1.0f },
+		{ 0x7BFF, 65504.0f },       // largest finite
+		{ 0xFBFF, -65504.0f },
+		{ 0x7C00, std::numeric_limits<float>::infinity() },
+		{ 0xFC00, -std::numeric_limits<float>::infinity() },
+	};
+	bool ok = true;
+	for (const auto& half : named)
+	{
+		uint32_t bits = 0;
+		std::memcpy(&bits, &half.second, sizeof(bits));
+		if (expected_bits(half.first) != bits)
+		{
+			std::cerr << "the expected value of half " << std::hex << half.first << std::dec << " is wrong\n";
+			ok = false;
+		}
+	}
+
+	const std::vector<uint8_t> file = build_tiff();
+	tiff::reader::Reader reader{ file.data(), file.size() };
+	reader.set_half_float(tiff::HalfFloat::Float);
+	if (reader.open() != tiff::Error::NoError)
+	{
+		std::cerr << "the halves do not open as float\n";
+		return 1;
+	}
+	ok = check_region(reader, tiff::Rect{ 0, 0, width, height }) && ok;
+	ok = check_region(reader, tiff::Rect{ 3, 120, 251, 136 }) && ok;
+	ok = check_region(reader, tiff::Rect{ 250, 0, 5, 256 }) && ok;
+
+	// quiet and signaling NaNs of both signs
+	for (uint16_t h : { 0x7E00, 0xFE00, 0x7C01, 0xFDFF })
+	{
+		float value = 0.0f;
+		const uint32_t bits = expected_bits(h);
+		std::memcpy(&value, &bits, sizeof(value));
+		if (!std::isnan(value))
+		{
+			std::cerr << "half " << std::hex << h << std::dec << " is expected to be a number\n";
+			ok = false;
+		}
+	}
+
+	if (ok)
+	{
+		std::cout << "all halves widened\n";
+	}
+	return ok ? 0 : 1;
+}
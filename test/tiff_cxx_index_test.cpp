@@ -0,0 +1,209 @@
+#include "tiff_cxx.h"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <filesystem>
+
+// the sidecar index stands in for the IFD chain while the file is unchanged, and is ignored once the file's first
+// bytes differ even though its size and modification time are the same
+
+static uint16_t sample_value(uint32_t x, uint32_t y, uint32_t frame, uint32_t base)
+{
+	return uint16_t(base + x * 31 + y * 17 + frame * 1001);
+}
+
+static bool write_file(const std::filesystem::path& path, uint32_t width, uint32_t height, uint32_t frames, uint32_t base)
+{
+	tiff::writer::FrameInfo info{};
+	info.width = width;
+	info.height = height;
+	info.bits_per_sample = 16;
+
+	tiff::writer::Writer writer{ path };
+	if (writer.open() != tiff::Error::NoError)
+	{
+		return false;
+	}
+	std::vector<uint16_t> pixels(size_t(width) * height);
+	for (uint32_t frame = 0; frame < frames; ++frame)
+	{
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				pixels[size_t(y) * width + x] = sample_value(x, y, frame, base);
+			}
+		}
+		if (writer.write_frame(info, pixels.data()) != tiff::Error::NoError)
+		{
+			return false;
+		}
+	}
+	return writer.close() == tiff::Error::NoError;
+}
+
+// all frames read at once, which takes their layout from the index when one was loaded
+static bool check_frames(const std::filesystem::path& path, const std::filesystem::path& index_path,
+	uint32_t width, uint32_t height, uint32_t frames, uint32_t base)
+{
+	tiff::reader::Reader reader{ path };
+	reader.set_index_path(index_path);
+	if (reader.open() != tiff::Error::NoError || reader.count_frames() != frames)
+	{
+		return false;
+	}
+	std::vector<uint16_t> volume(size_t(width) * height * frames);
+	if (reader.read_frames(0, 0, 0, 1, tiff::reader::OutputLayout{}, volume.data(), volume.size() * 2) != tiff::Error::NoError)
+	{
+		return false;
+	}
+	for (uint32_t frame = 0; frame < frames; ++frame)
+	{
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				if (volume[(size_t(frame) * height + y) * width + x] != sample_value(x, y, frame, base))
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	// the volume bytes of transposed frames are the same, a point in the last row only exists in the right geometry
+	const std::vector<tiff::Vec2ul> points{ { width - 1, height - 1 } };
+	std::vector<uint16_t> profile(frames);
+	if (reader.read_profile(0, points, 0, 0, profile.data(), profile.size() * 2) != tiff::Error::NoError)
+	{
+		return false;
+	}
+	for (uint32_t frame = 0; frame < frames; ++frame)
+	{
+		if (profile[frame] != sample_value(width - 1, height - 1, frame, base))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// zeroes the ImageWidth of the last IFD, the chain walk then fails on that frame
+static bool break_last_ifd(const std::filesystem::path& path)
+{
+	std::vector<uint8_t> file{};
+	{
+		std::ifstream stream{ path, std::ios_base::binary };
+		file.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+	}
+	if (file.size() < 8)
+	{
+		return false;
+	}
+	const bool big_endian = file[0] == 'M';
+	auto get = [&](size_t at, uint32_t bytes)
+	{
+		uint32_t value = 0;
+		for (uint32_t b = 0; b < bytes; ++b)
+		{
+			value |= uint32_t(file[at + b]) << (big_endian ? (bytes - 1 - b) * 8 : b * 8);
+		}
+		return value;
+	};
+
+	uint32_t last = 0;
+	for (uint32_t ifd = get(4, 4); ifd != 0 && ifd + 6 <= file.size(); ifd = get(ifd + 2 + get(ifd, 2) * 12, 4))
+	{
+		last = ifd;
+	}
+	for (uint32_t i = 0; last != 0 && i < get(last, 2); ++i)
+	{
+		const size_t at = last + 2 + size_t(i) * 12;
+		if (get(at, 2) == 256)
+		{
+			std::fill(file.begin() + at + 8, file.begin() + at + 12, uint8_t(0));
+			std::ofstream stream{ path, std::ios_base::binary | std::ios_base::trunc };
+			stream.write((const char*)file.data(), std::streamsize(file.size()));
+			return stream.good();
+		}
+	}
+	return false;
+}
+
+static bool run(const std::filesystem::path& path, const std::filesystem::path& index_path)
+{
+	const uint32_t frames = 5;
+	if (!write_file(path, 64, 32, frames, 0))
+	{
+		std::cerr << "writing the file failed\n";
+		return false;
+	}
+	{
+		tiff::reader::Reader reader{ path };
+		reader.set_index_path(index_path);
+		if (reader.open() != tiff::Error::NoError || reader.save_index() != tiff::Error::NoError)
+		{
+			std::cerr << "saving the index failed\n";
+			return false;
+		}
+	}
+	if (!check_frames(path, index_path, 64, 32, frames, 0))
+	{
+		std::cerr << "frames read with the index are wrong\n";
+		return false;
+	}
+
+	// past the hashed first bytes, the same size and time: the index is still taken and the broken IFD never read
+	const auto time = std::filesystem::last_write_time(path);
+	if (!break_last_ifd(path))
+	{
+		std::cerr << "the last IFD was not found\n";
+		return false;
+	}
+	std::filesystem::last_write_time(path, time);
+	if (check_frames(path, "", 64, 32, frames, 0))
+	{
+		std::cerr << "the broken IFD did not break walking the chain\n";
+		return false;
+	}
+	if (!check_frames(path, index_path, 64, 32, frames, 0))
+	{
+		std::cerr << "the index was not used for an unchanged header\n";
+		return false;
+	}
+
+	// transposed frames of other values make a file of the same size, only the header hash tells it apart
+	const auto size = std::filesystem::file_size(path);
+	if (!write_file(path, 32, 64, frames, 500) || std::filesystem::file_size(path) != size)
+	{
+		std::cerr << "rewriting the file failed\n";
+		return false;
+	}
+	std::filesystem::last_write_time(path, time);
+	if (!check_frames(path, index_path, 32, 64, frames, 500))
+	{
+		std::cerr << "a stale index was used\n";
+		return false;
+	}
+	return true;
+}
+
+int main()
+{
+	const std::filesystem::path dir = std::filesystem::temp_directory_path();
+	const std::filesystem::path path = dir / "tinytiff_cxx_index.tif";
+	const std::filesystem::path index_path = dir / "tinytiff_cxx_index.tif.idx";
+	const bool ok = run(path, index_path);
+	std::error_code ec{};
+	std::filesystem::remove(path, ec);
+	std::filesystem::remove(index_path, ec);
+	if (ok)
+	{
+		std::cout << "sidecar index checked\n";
+	}
+	return ok ? 0 : 1;
+}
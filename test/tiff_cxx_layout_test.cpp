@@ -0,0 +1,213 @@
+#include "tiff_cxx.h"
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+#include <filesystem>
+
+// regions and volumes decoded into strided output layouts: packed planes, interleaved pixels, padded pixels and rows,
+// column major planes and padded frames. every sample is checked where its strides put it and every other byte
+// of the buffer must be left alone
+
+static const uint32_t width = 150;
+static const uint32_t height = 90;
+static const uint16_t samples = 3;
+static const uint32_t frames = 3;
+static const uint8_t untouched = 0xAB;
+
+static uint16_t sample_value(uint32_t x, uint32_t y, uint32_t c, uint32_t frame)
+{
+	return uint16_t(x * 31 + y * 17 + c * 7 + frame * 1001);
+}
+
+static bool write_file(const std::filesystem::path& path)
+{
+	tiff::writer::FrameInfo info{};
+	info.width = width;
+	info.height = height;
+	info.bits_per_sample = 16;
+	info.samples_per_pixel = samples;
+	info.rows_per_strip = 16;
+
+	tiff::writer::Writer writer{ path };
+	if (writer.open() != tiff::Error::NoError)
+	{
+		return false;
+	}
+	std::vector<uint16_t> pixels(size_t(width) * height * samples);
+	for (uint32_t frame = 0; frame < frames; ++frame)
+	{
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				for (uint16_t c = 0; c < samples; ++c)
+				{
+					pixels[(size_t(y) * width + x) * samples + c] = sample_value(x, y, c, frame);
+				}
+			}
+		}
+		if (writer.write_frame(info, pixels.data()) != tiff::Error::NoError)
+		{
+			return false;
+		}
+	}
+	return writer.close() == tiff::Error::NoError;
+}
+
+struct Case
+{
+	std::string name;
+	tiff::reader::OutputLayout layout;
+	tiff::Rect region;
+	uint16_t first_sample;
+	uint16_t sample_count;
+};
+
+// the strides of `layout` with the zero ones filled in: a sample plane and a frame are the whole of what the others span
+static tiff::reader::OutputLayout resolve(const Case& test)
+{
+	tiff::reader::OutputLayout strides = test.layout;
+	strides.column_stride = strides.column_stride != 0 ? strides.column_stride : 2;
+	strides.row_stride = strides.row_stride != 0 ? strides.row_stride : test.region.width * strides.column_stride;
+	const uint64_t plane = std::max(test.region.height * strides.row_stride, test.region.width * strides.column_stride);
+	strides.sample_stride = strides.sample_stride != 0 ? strides.sample_stride : plane;
+	strides.frame_stride = strides.frame_stride != 0 ? strides.frame_stride : std::max(test.sample_count * strides.sample_stride, plane);
+	return strides;
+}
+
+static size_t buffer_bytes(const Case& test, const tiff::reader::OutputLayout& strides, uint32_t frame_count)
+{
+	return size_t((test.region.width - 1) * strides.column_stride + (test.region.height - 1) * strides.row_stride
+		+ (test.sample_count - 1) * strides.sample_stride + (frame_count - 1) * strides.frame_stride + 2);
+}
+
+static bool verify(const Case& test, const std::vector<uint8_t>& buffer, const tiff::reader::OutputLayout& strides,
+	uint32_t first_frame, uint32_t frame_count)
+{
+	std::vector<bool> written(buffer.size(), false);
+	for (uint32_t f = 0; f < frame_count; ++f)
+	{
+		for (uint16_t c = 0; c < test.sample_count; ++c)
+		{
+			for (uint32_t y = 0; y < test.region.height; ++y)
+			{
+				for (uint32_t x = 0; x < test.region.width; ++x)
+				{
+					const size_t at = size_t(f * strides.frame_stride + c * strides.sample_stride + y * strides.row_stride + x * strides.column_stride);
+					uint16_t v = 0;
+					std::memcpy(&v, &buffer[at], 2);
+					if (v != sample_value(test.region.x + x, test.region.y + y, test.first_sample + c, first_frame + f))
+					{
+						std::cerr << test.name << ": frame " << f << " sample " << c << " is wrong at " << x << ", " << y << "\n";
+						return false;
+					}
+					written[at] = written[at + 1] = true;
+				}
+			}
+		}
+	}
+	for (size_t i = 0; i < buffer.size(); ++i)
+	{
+		if (!written[i] && buffer[i] != untouched)
+		{
+			std::cerr << test.name << ": byte " << i << " between the samples was written\n";
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool check(tiff::reader::Reader& reader, const Case& test)
+{
+	tiff::reader::OutputLayout strides = resolve(test);
+	std::vector<uint8_t> buffer(buffer_bytes(test, strides, 1), untouched);
+	if (reader.read_samples(0, test.first_sample, test.sample_count, test.region, test.layout, buffer.data(), buffer.size()) != tiff::Error::NoError)
+	{
+		std::cerr << test.name << ": read_samples failed\n";
+		return false;
+	}
+	if (!verify(test, buffer, strides, 0, 1))
+	{
+		return false;
+	}
+
+	// volumes are whole frames
+	if (test.region.width != width || test.region.height != height)
+	{
+		return true;
+	}
+	buffer.assign(buffer_bytes(test, strides, frames), untouched);
+	if (reader.read_frames(0, frames, test.first_sample, test.sample_count, test.layout, buffer.data(), buffer.size()) != tiff::Error::NoError)
+	{
+		std::cerr << test.name << ": read_frames failed\n";
+		return false;
+	}
+	return verify(test, buffer, strides, 0, frames);
+}
+
+static bool run(const std::filesystem::path& path)
+{
+	if (!write_file(path))
+	{
+		std::cerr << "writing the file failed\n";
+		return false;
+	}
+	tiff::reader::Reader reader{ path };
+	if (reader.open() != tiff::Error::NoError)
+	{
+		std::cerr << "open failed\n";
+		return false;
+	}
+
+	const tiff::Rect whole{ 0, 0, width, height };
+	const tiff::Rect part{ 7, 11, 61, 43 };
+	const uint64_t padded_row = uint64_t(width + 5) * 2;
+	const std::vector<Case> cases{
+		{ "packed planes", {}, whole, 0, samples },
+		{ "interleaved", { samples * 2u, 0, 2, 0 }, whole, 0, samples },
+		{ "padded pixels", { 8, 0, 2, 0 }, whole, 0, samples },
+		{ "padded rows and frames", { 0, padded_row, padded_row * height, padded_row * height * 2 + 6 }, whole, 1, 2 },
+		{ "column major", { height * 2u, 2, uint64_t(width) * height * 2, 0 }, whole, 0, samples },
+		{ "column major interleaved", { uint64_t(height) * samples * 2, samples * 2u, 2, 0 }, whole, 0, samples },
+		{ "interleaved region", { 2 * 2u, 0, 2, 0 }, part, 1, 2 },
+		{ "column major region", { uint64_t(part.height + 3) * 2, 2, uint64_t(part.width) * (part.height + 3) * 2, 0 }, part, 0, samples },
+	};
+	for (const auto& test : cases)
+	{
+		if (!check(reader, test))
+		{
+			return false;
+		}
+	}
+
+	std::vector<uint8_t> buffer(size_t(width) * height * samples * 2);
+	if (reader.read_samples(0, 0, samples, whole, tiff::reader::OutputLayout{ 3, 0, 0, 0 }, buffer.data(), buffer.size())
+		!= tiff::Error::InvalidOutputLayout)
+	{
+		std::cerr << "a stride of a sample and a half was taken\n";
+		return false;
+	}
+	if (reader.read_samples(0, 0, samples, whole, tiff::reader::OutputLayout{ 8, 0, 2, 0 }, buffer.data(), buffer.size())
+		!= tiff::Error::BufferTooSmall)
+	{
+		std::cerr << "padded pixels were written into a buffer too small for them\n";
+		return false;
+	}
+	return true;
+}
+
+int main()
+{
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "tinytiff_cxx_layout.tif";
+	const bool ok = run(path);
+	std::error_code ec{};
+	std::filesystem::remove(path, ec);
+	if (ok)
+	{
+		std::cout << "output layouts filled\n";
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+﻿#include "tiff_cxx.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+
+// regression benchmark: opening a file must cost its header and first IFD only,
+// so a huge file with thousands of strips opens as fast as a tiny one
+
+static bool write_file(const std::filesystem::path& path, uint32_t width, uint32_t height, uint32_t rows_per_strip)
+{
+	tiff::writer::Writer writer{ path };
+	if (writer.open() != tiff::Error::NoError)
+	{
+		return false;
+	}
+	tiff::writer::FrameInfo info{};
+	info.width = width;
+	info.height = height;
+	info.rows_per_strip = rows_per_strip;
+	std::vector<uint8_t> data(static_cast<size_t>(width) * height, 7);
+	return writer.write_frame(info, data.data()) == tiff::Error::NoError
+		&& writer.close() == tiff::Error::NoError;
+}
+
+static double median_open_us(const std::filesystem::path& path, int runs)
+{
+	std::vector<double> times{};
+	for (int i = 0; i < runs; ++i)
+	{
+		auto begin = std::chrono::steady_clock::now();
+		tiff::reader::Reader reader{ path };
+		if (reader.open() != tiff::Error::NoError)
+		{
+			return -1.0;
+		}
+		auto end = std::chrono::steady_clock::now();
+		times.emplace_back(std::chrono::duration<double, std::micro>(end - begin).count());
+	}
+	std::sort(times.begin(), times.end());
+	return times[times.size() / 2];
+}
+
+int main()
+{
+	const auto dir = std::filesystem::temp_directory_path();
+	const auto small_path = dir / "tinytiff_cxx_open_small.tif";
+	const auto large_path = dir / "tinytiff_cxx_open_large.tif";
+
+	// 8192 strips of one row, then 4 GiB of (sparse) trailing bytes which only a full read would touch
+	if (!write_file(small_path, 64, 64, 64) || !write_file(large_path, 4096, 8192, 1))
+	{
+		std::cerr << "writing the test files failed\n";
+		return 1;
+	}
+	std::error_code ec{};
+	std::filesystem::resize_file(large_path, std::filesystem::file_size(large_path) + (uint64_t(4) << 30), ec);
+
+	const int runs = 21;
+	const double small_us = median_open_us(small_path, runs);
+	const double large_us = median_open_us(large_path, runs);
+
+	std::filesystem::remove(small_path, ec);
+	std::filesystem::remove(large_path, ec);
+
+	std::cout << "open small: " << small_us << " us, open large: " << large_us << " us\n";
+	if (small_us < 0.0 || large_us < 0.0)
+	{
+		std::cerr << "open failed\n";
+		return 1;
+	}
+	// generous, timing noise must not fail the run but reading strip tables or the file would
+	if (large_us > small_us * 4.0 + 100.0)
+	{
+		std::cerr << "open time grows with the file size\n";
+		return 1;
+	}
+	return 0;
+}
\ No newline at end of file
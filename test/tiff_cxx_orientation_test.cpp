@@ -0,0 +1,186 @@
+#include "tiff_cxx.h"
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+// a frame stored in each of the 8 orientations is read in display order, whole and as a region, and in stored order
+// with orientation off. the display of every orientation is worked out here from the meaning of its 0th row and column
+
+static const uint32_t stored_width = 13;
+static const uint32_t stored_height = 7;
+static const uint32_t rows_per_strip = 3;
+
+static uint16_t stored_value(uint32_t x, uint32_t y)
+{
+	return uint16_t(1 + x + y * stored_width);
+}
+
+// the stored pixel shown at display position (x, y)
+static uint16_t display_value(uint16_t orientation, uint32_t x, uint32_t y)
+{
+	const uint32_t w = stored_width;
+	const uint32_t h = stored_height;
+	switch (orientation)
+	{
+	case 2: return stored_value(w - 1 - x, y);
+	case 3: return stored_value(w - 1 - x, h - 1 - y);
+	case 4: return stored_value(x, h - 1 - y);
+	case 5: return stored_value(y, x);
+	case 6: return stored_value(y, h - 1 - x);
+	case 7: return stored_value(w - 1 - y, h - 1 - x);
+	case 8: return stored_value(w - 1 - y, x);
+	default: return stored_value(x, y);
+	}
+}
+
+// 16 bit little endian strips, each short entry in the first two bytes of its value
+static std::vector<uint8_t> build_tiff(uint16_t orientation)
+{
+	std::vector<uint8_t> file(8, 0);
+	auto put = [&file](uint64_t value, uint32_t bytes, size_t at)
+	{
+		for (uint32_t b = 0; b < bytes; ++b)
+		{
+			file[at + b] = uint8_t(value >> (b * 8));
+		}
+	};
+
+	std::vector<uint32_t> offsets{};
+	std::vector<uint32_t> counts{};
+	for (uint32_t y = 0; y < stored_height; ++y)
+	{
+		if (y % rows_per_strip == 0)
+		{
+			offsets.emplace_back(uint32_t(file.size()));
+		}
+		for (uint32_t x = 0; x < stored_width; ++x)
+		{
+			file.resize(file.size() + 2);
+			put(stored_value(x, y), 2, file.size() - 2);
+		}
+		if (y % rows_per_strip == rows_per_strip - 1 || y == stored_height - 1)
+		{
+			counts.emplace_back(uint32_t(file.size()) - offsets.back());
+		}
+	}
+	auto append_array = [&](const std::vector<uint32_t>& array)
+	{
+		const size_t at = file.size();
+		file.resize(at + array.size() * 4);
+		for (size_t i = 0; i < array.size(); ++i)
+		{
+			put(array[i], 4, at + i * 4);
+		}
+		return uint32_t(at);
+	};
+	const uint32_t offsets_at = append_array(offsets);
+	const uint32_t counts_at = append_array(counts);
+
+	struct Entry
+	{
+		uint16_t tag;
+		uint16_t type;
+		uint32_t count;
+		uint32_t value;
+	};
+	const std::vector<Entry> entries{
+		{ 256, 4, 1, stored_width },
+		{ 257, 4, 1, stored_height },
+		{ 258, 3, 1, 16 },
+		{ 259, 3, 1, 1 },
+		{ 262, 3, 1, 1 },
+		{ 273, 4, uint32_t(offsets.size()), offsets_at },
+		{ 274, 3, 1, orientation },
+		{ 277, 3, 1, 1 },
+		{ 278, 4, 1, rows_per_strip },
+		{ 279, 4, uint32_t(counts.size()), counts_at },
+	};
+	const size_t ifd = file.size();
+	file.resize(ifd + 2 + entries.size() * 12 + 4, 0);
+	put(entries.size(), 2, ifd);
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		const size_t at = ifd + 2 + i * 12;
+		put(entries[i].tag, 2, at);
+		put(entries[i].type, 2, at + 2);
+		put(entries[i].count, 4, at + 4);
+		put(entries[i].value, entries[i].type == 3 ? 2 : 4, at + 8);
+	}
+	file[0] = file[1] = 'I';
+	put(42, 2, 2);
+	put(ifd, 4, 4);
+	return file;
+}
+
+static bool check_region(tiff::reader::Reader& reader, const tiff::Rect& region, uint16_t orientation, bool apply)
+{
+	std::vector<uint16_t> buffer(size_t(region.width) * region.height);
+	if (reader.read_region(0, 0, region, buffer.data(), buffer.size() * 2) != tiff::Error::NoError)
+	{
+		return false;
+	}
+	for (uint32_t y = 0; y < region.height; ++y)
+	{
+		for (uint32_t x = 0; x < region.width; ++x)
+		{
+			const uint32_t dx = region.x + x;
+			const uint32_t dy = region.y + y;
+			if (buffer[size_t(y) * region.width + x] != (apply ? display_value(orientation, dx, dy) : stored_value(dx, dy)))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static bool check(uint16_t orientation, bool apply)
+{
+	const std::string name = "orientation " + std::to_string(orientation) + (apply ? " displayed" : " stored");
+	const std::vector<uint8_t> file = build_tiff(orientation);
+	tiff::reader::Reader reader{ file.data(), file.size() };
+	reader.set_apply_orientation(apply);
+	if (reader.open() != tiff::Error::NoError)
+	{
+		std::cerr << name << ": open failed\n";
+		return false;
+	}
+
+	const bool transposed = apply && orientation >= 5;
+	const uint32_t width = transposed ? stored_height : stored_width;
+	const uint32_t height = transposed ? stored_width : stored_height;
+	const tiff::Vec2ul level = reader.level_size(0);
+	if (uint16_t(reader.orientation()) != orientation || reader.width() != width || reader.height() != height
+		|| level.x != width || level.y != height)
+	{
+		std::cerr << name << ": the frame is " << reader.width() << "x" << reader.height() << "\n";
+		return false;
+	}
+	if (!check_region(reader, tiff::Rect{ 0, 0, width, height }, orientation, apply))
+	{
+		std::cerr << name << ": the frame is wrong\n";
+		return false;
+	}
+	if (!check_region(reader, tiff::Rect{ 2, 1, 4, 5 }, orientation, apply))
+	{
+		std::cerr << name << ": the region is wrong\n";
+		return false;
+	}
+	return true;
+}
+
+int main()
+{
+	bool ok = true;
+	for (uint16_t orientation = 1; orientation <= 8; ++orientation)
+	{
+		ok = check(orientation, true) && ok;
+		ok = check(orientation, false) && ok;
+	}
+	if (ok)
+	{
+		std::cout << "all orientations displayed\n";
+	}
+	return ok ? 0 : 1;
+}
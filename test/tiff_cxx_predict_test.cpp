@@ -0,0 +1,156 @@
+#include "tiff_cxx.h"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <filesystem>
+
+// indexing long stacks with the IFDs ahead guessed from the regular layout of the chain: every frame is found and read
+// back right, with far fewer reads than frames while the layout is regular and also when it changes on the way
+
+// counts the calls the reader makes, a batch of guessed IFDs is one call
+class CountingSource : public tiff::reader::ByteSource
+{
+public:
+	CountingSource(std::vector<uint8_t> data) noexcept : _data(std::move(data)) {}
+
+	uint64_t size() const noexcept override
+	{
+		return _data.size();
+	}
+
+	uint64_t read_at(uint64_t offset, void* buffer, uint64_t count) noexcept override
+	{
+		++calls;
+		if (offset >= _data.size())
+		{
+			return 0;
+		}
+		count = std::min<uint64_t>(count, _data.size() - offset);
+		std::copy(_data.begin() + offset, _data.begin() + offset + count, (uint8_t*)buffer);
+		return count;
+	}
+
+	void read_batch(std::vector<tiff::reader::ReadRequest>& requests) noexcept override
+	{
+		const uint64_t before = calls;
+		for (auto& request : requests)
+		{
+			request.result = read_at(request.offset, request.data, request.size);
+		}
+		calls = before + 1;
+	}
+
+	uint64_t calls = 0;
+
+private:
+	std::vector<uint8_t> _data{};
+};
+
+static uint16_t sample_value(uint32_t x, uint32_t y, uint32_t frame)
+{
+	return uint16_t(x * 31 + y * 17 + frame * 1001);
+}
+
+// `description_every` frames get a description of growing length, which moves everything after them
+static std::vector<uint8_t> build_file(uint32_t frames, uint32_t pyramid_levels, uint32_t description_every)
+{
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "tinytiff_cxx_predict.tif";
+	tiff::writer::FrameInfo info{};
+	info.width = 24;
+	info.height = 10;
+	info.bits_per_sample = 16;
+	info.pyramid_levels = pyramid_levels;
+	info.pyramid_storage = tiff::writer::PyramidStorage::Chained;
+
+	tiff::writer::Writer writer{ path };
+	bool ok = writer.open() == tiff::Error::NoError;
+	std::vector<uint16_t> pixels(size_t(info.width) * info.height);
+	for (uint32_t frame = 0; frame < frames && ok; ++frame)
+	{
+		for (uint32_t y = 0; y < info.height; ++y)
+		{
+			for (uint32_t x = 0; x < info.width; ++x)
+			{
+				pixels[size_t(y) * info.width + x] = sample_value(x, y, frame);
+			}
+		}
+		info.description.clear();
+		if (description_every != 0 && frame % description_every == description_every - 1)
+		{
+			info.description.assign(8 + frame % 50, 'd');
+		}
+		ok = writer.write_frame(info, pixels.data()) == tiff::Error::NoError;
+	}
+	ok = writer.close() == tiff::Error::NoError && ok;
+
+	std::vector<uint8_t> file{};
+	if (ok)
+	{
+		std::ifstream stream{ path, std::ios_base::binary };
+		file.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+	}
+	std::error_code ec{};
+	std::filesystem::remove(path, ec);
+	return file;
+}
+
+static bool check(const std::string& name, uint32_t frames, uint32_t pyramid_levels, uint32_t description_every)
+{
+	auto source = std::make_shared<CountingSource>(build_file(frames, pyramid_levels, description_every));
+	tiff::reader::Reader reader{ source };
+	if (source->size() == 0 || reader.open() != tiff::Error::NoError)
+	{
+		std::cerr << name << ": open failed\n";
+		return false;
+	}
+	const uint64_t before = source->calls;
+	if (reader.count_frames() != frames)
+	{
+		std::cerr << name << ": " << reader.count_frames() << " frames instead of " << frames << "\n";
+		return false;
+	}
+	const uint64_t calls = source->calls - before;
+	if (calls * 4 > frames)
+	{
+		std::cerr << name << ": indexing " << frames << " frames took " << calls << " reads\n";
+		return false;
+	}
+
+	const uint32_t width = reader.width();
+	const uint32_t height = reader.height();
+	std::vector<uint16_t> volume(size_t(width) * height * frames);
+	if (reader.read_frames(0, 0, 0, 1, tiff::reader::OutputLayout{}, volume.data(), volume.size() * 2) != tiff::Error::NoError)
+	{
+		std::cerr << name << ": read_frames failed\n";
+		return false;
+	}
+	for (uint32_t frame = 0; frame < frames; ++frame)
+	{
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				if (volume[(size_t(frame) * height + y) * width + x] != sample_value(x, y, frame))
+				{
+					std::cerr << name << ": frame " << frame << " is wrong at " << x << ", " << y << "\n";
+					return false;
+				}
+			}
+		}
+	}
+	std::cout << name << ": " << frames << " frames indexed in " << calls << " reads\n";
+	return true;
+}
+
+int main()
+{
+	bool ok = true;
+	ok = check("regular", 1000, 0, 0) && ok;
+	ok = check("chained levels", 600, 2, 0) && ok;
+	ok = check("descriptions", 1000, 0, 97) && ok;
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,228 @@
+#include "tiff_cxx.h"
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include <type_traits>
+
+// projections of every mode over runs of frames (long enough that each frame is read while the one before is reduced)
+// are compared pixel by pixel to projections worked out here, and frames of another shape have to be refused
+
+static const uint32_t width = 11;
+static const uint32_t height = 6;
+static const uint16_t samples = 2;
+static const uint32_t frames = 9;
+
+template<typename value_t>
+static value_t sample_value(uint32_t frame, size_t i, int64_t bias)
+{
+	const int64_t v = int64_t((i * 389 + frame * 7937) % 1000) + bias;
+	if constexpr (std::is_floating_point_v<value_t>)
+	{
+		return value_t(v) + value_t(0.5);
+	}
+	else
+	{
+		return value_t(v);
+	}
+}
+
+template<typename value_t>
+static tiff::writer::FrameInfo frame_info()
+{
+	tiff::writer::FrameInfo info{};
+	info.width = width;
+	info.height = height;
+	info.bits_per_sample = sizeof(value_t) * 8;
+	info.samples_per_pixel = samples;
+	info.sample_format = std::is_floating_point_v<value_t> ? tiff::SampleFormat::Float
+		: std::is_signed_v<value_t> ? tiff::SampleFormat::Int : tiff::SampleFormat::Uint;
+	info.rows_per_strip = 4;
+	return info;
+}
+
+template<typename value_t>
+static bool write_file(const std::filesystem::path& path, int64_t bias)
+{
+	const tiff::writer::FrameInfo info = frame_info<value_t>();
+	tiff::writer::Writer writer{ path };
+	if (writer.open() != tiff::Error::NoError)
+	{
+		return false;
+	}
+	for (uint32_t frame = 0; frame < frames; ++frame)
+	{
+		std::vector<value_t> pixels(size_t(width) * height * samples);
+		for (size_t i = 0; i < pixels.size(); ++i)
+		{
+			pixels[i] = sample_value<value_t>(frame, i, bias);
+		}
+		if (writer.write_frame(info, pixels.data()) != tiff::Error::NoError)
+		{
+			return false;
+		}
+	}
+	return writer.close() == tiff::Error::NoError;
+}
+
+template<typename value_t>
+static bool check_mode(tiff::reader::Reader& reader, const std::string& type_name, int64_t bias, tiff::ProjectionMode mode,
+	uint16_t sample, uint32_t first, uint32_t count)
+{
+	typedef std::conditional_t<std::is_floating_point_v<value_t>, double, std::conditional_t<std::is_signed_v<value_t>, int64_t, uint64_t>> sum_t;
+	const char* mode_names[] = { "max", "min", "sum", "mean" };
+	const std::string name = type_name + " " + mode_names[int(mode)] + " of frames " + std::to_string(first) + "+" + std::to_string(count);
+	const uint32_t frames_used = count == 0 ? frames - first : count;
+	const size_t plane = size_t(width) * height;
+	const size_t out_bytes = mode == tiff::ProjectionMode::Sum ? 8 : sizeof(value_t);
+
+	std::vector<uint8_t> buffer(plane * out_bytes);
+	if (reader.project_frames(sample, mode, first, count, buffer.data(), buffer.size()) != tiff::Error::NoError)
+	{
+		std::cerr << name << ": project_frames failed\n";
+		return false;
+	}
+	for (size_t p = 0; p < plane; ++p)
+	{
+		double sum = 0.0;
+		double lo = INFINITY;
+		double hi = -INFINITY;
+		for (uint32_t frame = first; frame < first + frames_used; ++frame)
+		{
+			const double v = double(sample_value<value_t>(frame, p * samples + sample, bias));
+			sum += v;
+			lo = std::min(lo, v);
+			hi = std::max(hi, v);
+		}
+		double expected = 0.0;
+		double got = 0.0;
+		switch (mode)
+		{
+		case tiff::ProjectionMode::Max: expected = hi; break;
+		case tiff::ProjectionMode::Min: expected = lo; break;
+		case tiff::ProjectionMode::Sum: expected = sum; break;
+		// integer means round half away from zero
+		case tiff::ProjectionMode::Mean: expected = std::is_floating_point_v<value_t> ? sum / frames_used : std::round(sum / frames_used); break;
+		}
+		if (mode == tiff::ProjectionMode::Sum)
+		{
+			got = double(((const sum_t*)buffer.data())[p]);
+		}
+		else
+		{
+			got = double(((const value_t*)buffer.data())[p]);
+		}
+		if (std::abs(got - expected) > (std::is_floating_point_v<value_t> ? 1e-3 : 0.0))
+		{
+			std::cerr << name << ": pixel " << p << " is " << got << " instead of " << expected << "\n";
+			return false;
+		}
+	}
+	return true;
+}
+
+template<typename value_t>
+static bool check_type(const std::filesystem::path& path, const std::string& type_name, int64_t bias)
+{
+	if (!write_file<value_t>(path, bias))
+	{
+		std::cerr << type_name << ": writing the file failed\n";
+		return false;
+	}
+	tiff::reader::Reader reader{ path };
+	if (reader.open() != tiff::Error::NoError)
+	{
+		std::cerr << type_name << ": open failed\n";
+		return false;
+	}
+	bool ok = true;
+	for (tiff::ProjectionMode mode : { tiff::ProjectionMode::Max, tiff::ProjectionMode::Min, tiff::ProjectionMode::Sum, tiff::ProjectionMode::Mean })
+	{
+		ok = check_mode<value_t>(reader, type_name, bias, mode, 1, 0, 0) && ok;
+		ok = check_mode<value_t>(reader, type_name, bias, mode, 0, 2, 6) && ok;
+		ok = check_mode<value_t>(reader, type_name, bias, mode, 1, 4, 1) && ok;
+		ok = check_mode<value_t>(reader, type_name, bias, mode, 0, 7, 0) && ok;
+	}
+
+	std::vector<uint64_t> buffer(size_t(width) * height);
+	if (reader.project_frames(0, tiff::ProjectionMode::Sum, 0, 0, buffer.data(), buffer.size() * 8 - 1) != tiff::Error::BufferTooSmall)
+	{
+		std::cerr << type_name << ": a sum went into a buffer too small for it\n";
+		ok = false;
+	}
+	if (reader.project_frames(0, tiff::ProjectionMode::Max, frames - 1, 2, buffer.data(), buffer.size() * 8) != tiff::Error::NoMoreImagesInTiff)
+	{
+		std::cerr << type_name << ": frames after the last one were projected\n";
+		ok = false;
+	}
+	return ok;
+}
+
+// the third frame is one row shorter
+static bool check_inconsistent(const std::filesystem::path& path)
+{
+	tiff::writer::FrameInfo info = frame_info<uint16_t>();
+	tiff::writer::Writer writer{ path };
+	if (writer.open() != tiff::Error::NoError)
+	{
+		return false;
+	}
+	for (uint32_t frame = 0; frame < 4; ++frame)
+	{
+		info.height = frame == 2 ? height - 1 : height;
+		const std::vector<uint16_t> pixels(size_t(info.width) * info.height * samples, uint16_t(frame));
+		if (writer.write_frame(info, pixels.data()) != tiff::Error::NoError)
+		{
+			return false;
+		}
+	}
+	if (writer.close() != tiff::Error::NoError)
+	{
+		return false;
+	}
+
+	tiff::reader::Reader reader{ path };
+	if (reader.open() != tiff::Error::NoError)
+	{
+		return false;
+	}
+	std::vector<uint16_t> buffer(size_t(width) * height);
+	bool ok = true;
+	for (tiff::ProjectionMode mode : { tiff::ProjectionMode::Max, tiff::ProjectionMode::Mean })
+	{
+		if (reader.project_frames(0, mode, 0, 0, buffer.data(), buffer.size() * 8) != tiff::Error::InconsistentFrames
+			|| reader.project_frames(0, mode, 1, 3, buffer.data(), buffer.size() * 8) != tiff::Error::InconsistentFrames)
+		{
+			std::cerr << "frames of another shape were projected\n";
+			ok = false;
+		}
+	}
+	if (reader.project_frames(0, tiff::ProjectionMode::Max, 0, 2, buffer.data(), buffer.size() * 2) != tiff::Error::NoError
+		|| buffer[0] != 1)
+	{
+		std::cerr << "the frames before the shorter one were not projected\n";
+		ok = false;
+	}
+	return ok;
+}
+
+int main()
+{
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "tinytiff_cxx_projection.tif";
+	bool ok = true;
+	ok = check_type<uint16_t>(path, "uint16", 0) && ok;
+	ok = check_type<int16_t>(path, "int16", -500) && ok;
+	ok = check_type<uint8_t>(path, "uint8", -750) && ok;
+	ok = check_type<float>(path, "float", -500) && ok;
+	ok = check_inconsistent(path) && ok;
+	std::error_code ec{};
+	std::filesystem::remove(path, ec);
+	if (ok)
+	{
+		std::cout << "projections match\n";
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,197 @@
+#include "tiff_cxx.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <algorithm>
+#include <filesystem>
+
+// regions and frames read with read size caps from one byte to far more than the file come out the same,
+// and a source counting the reads shows that the cap bounds every read and that a large one merges the strips
+
+// the file in memory behind read_at only, so that every strip goes through a counted read
+class CountingSource : public tiff::reader::ByteSource
+{
+public:
+	CountingSource(std::vector<uint8_t> bytes)
+		: _bytes(std::move(bytes))
+	{
+	}
+
+	uint64_t size() const noexcept override
+	{
+		return _bytes.size();
+	}
+
+	uint64_t read_at(uint64_t offset, void* buffer, uint64_t count) noexcept override
+	{
+		reads += 1;
+		largest_read = std::max(largest_read, count);
+		if (offset >= _bytes.size())
+		{
+			return 0;
+		}
+		count = std::min<uint64_t>(count, _bytes.size() - offset);
+		std::copy(_bytes.begin() + offset, _bytes.begin() + offset + count, (uint8_t*)buffer);
+		return count;
+	}
+
+	uint64_t reads = 0;
+	uint64_t largest_read = 0;
+
+private:
+	std::vector<uint8_t> _bytes{};
+};
+
+static const uint32_t width = 97;
+static const uint32_t height = 61;
+static const uint16_t samples = 2;
+static const uint32_t frames = 3;
+
+static bool write_file(const std::filesystem::path& path, uint32_t tile_size)
+{
+	tiff::writer::FrameInfo info{};
+	info.width = width;
+	info.height = height;
+	info.bits_per_sample = 16;
+	info.samples_per_pixel = samples;
+	info.rows_per_strip = 5;
+	info.tile_width = tile_size;
+	info.tile_length = tile_size;
+
+	tiff::writer::Writer writer{ path };
+	if (writer.open() != tiff::Error::NoError)
+	{
+		return false;
+	}
+	for (uint32_t frame = 0; frame < frames; ++frame)
+	{
+		std::vector<uint16_t> pixels(size_t(width) * height * samples);
+		for (size_t i = 0; i < pixels.size(); ++i)
+		{
+			pixels[i] = uint16_t(i * 13 + frame * 5003);
+		}
+		if (writer.write_frame(info, pixels.data()) != tiff::Error::NoError)
+		{
+			return false;
+		}
+	}
+	return writer.close() == tiff::Error::NoError;
+}
+
+struct Reads
+{
+	std::vector<uint16_t> region{};
+	std::vector<uint16_t> volume{};
+	uint64_t region_reads = 0;
+	uint64_t largest_region_read = 0;
+};
+
+static bool read_with_cap(const std::vector<uint8_t>& bytes, size_t cap, Reads& out)
+{
+	auto source = std::make_shared<CountingSource>(bytes);
+	tiff::reader::Reader reader{ source };
+	reader.set_max_read_size(cap);
+	if (reader.open() != tiff::Error::NoError)
+	{
+		return false;
+	}
+
+	// the first read of a frame loads its strip or tile offsets through the metadata window, after it only
+	// strips or tiles are read
+	uint16_t sample = 0;
+	if (reader.read_region(0, 0, tiff::Rect{ 0, 0, 1, 1 }, &sample, sizeof(sample)) != tiff::Error::NoError)
+	{
+		return false;
+	}
+	source->reads = 0;
+	source->largest_read = 0;
+	const tiff::Rect whole{ 0, 0, width, height };
+	const tiff::Rect part{ 7, 11, 41, 29 };
+	out.region.clear();
+	for (const tiff::Rect& region : { whole, part })
+	{
+		for (uint16_t c = 0; c < samples; ++c)
+		{
+			std::vector<uint16_t> buffer(size_t(region.width) * region.height);
+			if (reader.read_region(0, c, region, buffer.data(), buffer.size() * 2) != tiff::Error::NoError)
+			{
+				return false;
+			}
+			out.region.insert(out.region.end(), buffer.begin(), buffer.end());
+		}
+	}
+	out.region_reads = source->reads;
+	out.largest_region_read = source->largest_read;
+
+	out.volume.assign(size_t(width) * height * samples * frames, 0);
+	return reader.read_frames(0, frames, 0, samples, tiff::reader::OutputLayout{}, out.volume.data(), out.volume.size() * 2) == tiff::Error::NoError;
+}
+
+static bool check(const std::filesystem::path& path, const std::string& name, uint32_t tile_size)
+{
+	if (!write_file(path, tile_size))
+	{
+		std::cerr << name << ": writing the file failed\n";
+		return false;
+	}
+	std::ifstream stream{ path, std::ios::binary };
+	const std::vector<uint8_t> bytes{ std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>() };
+	stream.close();
+
+	// the largest piece of a strip or tile the reader ever needs on its own is one of its rows
+	const uint64_t block_row = uint64_t(tile_size != 0 ? tile_size : width) * samples * 2;
+
+	Reads reference{};
+	if (!read_with_cap(bytes, size_t(1) << 30, reference))
+	{
+		std::cerr << name << ": reading without a cap failed\n";
+		return false;
+	}
+	bool ok = true;
+	for (size_t cap : { size_t(1), size_t(100), size_t(4096), size_t(64 * 1024), size_t(4) * 1024 * 1024 })
+	{
+		Reads reads{};
+		if (!read_with_cap(bytes, cap, reads))
+		{
+			std::cerr << name << ": reading with a cap of " << cap << " bytes failed\n";
+			ok = false;
+			continue;
+		}
+		if (reads.region != reference.region || reads.volume != reference.volume)
+		{
+			std::cerr << name << ": a cap of " << cap << " bytes changed the samples\n";
+			ok = false;
+		}
+		if (reads.largest_region_read > std::max<uint64_t>(cap, block_row))
+		{
+			std::cerr << name << ": a cap of " << cap << " bytes let through a read of " << reads.largest_region_read << "\n";
+			ok = false;
+		}
+		if (cap < 4096 && reads.region_reads <= reference.region_reads)
+		{
+			std::cerr << name << ": " << reads.region_reads << " reads with a cap of " << cap << " bytes and "
+				<< reference.region_reads << " without\n";
+			ok = false;
+		}
+	}
+	return ok;
+}
+
+int main()
+{
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "tinytiff_cxx_read_size.tif";
+	bool ok = true;
+	ok = check(path, "strips", 0) && ok;
+	ok = check(path, "tiles", 32) && ok;
+	std::error_code ec{};
+	std::filesystem::remove(path, ec);
+	if (ok)
+	{
+		std::cout << "read size caps read the same samples\n";
+	}
+	return ok ? 0 : 1;
+}
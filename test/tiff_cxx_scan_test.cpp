@@ -0,0 +1,151 @@
+#include "tiff_cxx.h"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+
+// files of different shapes and frame counts are scanned together with a missing and a broken one, on one thread
+// and on several: the results come in the order of the paths, only the bad files get an error and frames are counted on request
+
+struct Expected
+{
+	uint32_t width;
+	uint32_t height;
+	uint16_t bits_per_sample;
+	uint16_t samples_per_pixel;
+	uint32_t frames;
+};
+
+static bool write_file(const std::filesystem::path& path, const Expected& expected)
+{
+	tiff::writer::FrameInfo info{};
+	info.width = expected.width;
+	info.height = expected.height;
+	info.bits_per_sample = expected.bits_per_sample;
+	info.samples_per_pixel = expected.samples_per_pixel;
+	info.rows_per_strip = 16;
+	info.description = path.filename().string();
+
+	tiff::writer::Writer writer{ path };
+	if (writer.open() != tiff::Error::NoError)
+	{
+		return false;
+	}
+	const std::vector<uint8_t> pixels(size_t(info.width) * info.height * info.samples_per_pixel * info.bits_per_sample / 8, 0);
+	for (uint32_t frame = 0; frame < expected.frames; ++frame)
+	{
+		if (writer.write_frame(info, pixels.data()) != tiff::Error::NoError)
+		{
+			return false;
+		}
+	}
+	return writer.close() == tiff::Error::NoError;
+}
+
+int main()
+{
+	const std::filesystem::path dir = std::filesystem::temp_directory_path();
+	const std::vector<Expected> files{
+		{ 31, 17, 16, 1, 5 },
+		{ 64, 9, 8, 3, 1 },
+		{ 7, 40, 32, 2, 12 },
+		{ 120, 33, 16, 4, 2 },
+		{ 1, 1, 8, 1, 30 },
+	};
+
+	// the good files with a missing one after the first and a broken one before the last
+	std::vector<std::filesystem::path> paths{};
+	std::vector<int> file_of_path{};
+	bool ok = true;
+	for (size_t i = 0; i < files.size(); ++i)
+	{
+		const std::filesystem::path path = dir / ("tinytiff_cxx_scan_" + std::to_string(i) + ".tif");
+		if (!write_file(path, files[i]))
+		{
+			std::cerr << "writing " << path << " failed\n";
+			ok = false;
+		}
+		if (i + 1 == files.size())
+		{
+			// a header pointing at an IFD past the end of the file
+			std::ofstream broken{ dir / "tinytiff_cxx_scan_broken.tif", std::ios::binary };
+			const char header[]{ 'I', 'I', 42, 0, 0, 1, 0, 0 };
+			broken.write(header, sizeof(header));
+			paths.emplace_back(dir / "tinytiff_cxx_scan_broken.tif");
+			file_of_path.emplace_back(-1);
+		}
+		paths.emplace_back(path);
+		file_of_path.emplace_back(int(i));
+		if (i == 0)
+		{
+			paths.emplace_back(dir / "tinytiff_cxx_scan_missing.tif");
+			file_of_path.emplace_back(-1);
+		}
+	}
+
+	for (uint32_t threads : { 1u, 3u, 0u, 100u })
+	{
+		for (bool count_frames : { false, true })
+		{
+			const std::string name = std::to_string(threads) + " threads" + (count_frames ? " counting frames" : "");
+			const std::vector<tiff::reader::FileMetadata> result = tiff::reader::scan_metadata(paths, count_frames, threads);
+			if (result.size() != paths.size())
+			{
+				std::cerr << name << ": " << result.size() << " results for " << paths.size() << " paths\n";
+				ok = false;
+				continue;
+			}
+			for (size_t p = 0; p < paths.size(); ++p)
+			{
+				const tiff::reader::FileMetadata& metadata = result[p];
+				if (metadata.path != paths[p])
+				{
+					std::cerr << name << ": result " << p << " is for " << metadata.path << "\n";
+					ok = false;
+					continue;
+				}
+				if (file_of_path[p] < 0)
+				{
+					if (metadata.error == tiff::Error::NoError)
+					{
+						std::cerr << name << ": " << paths[p] << " was scanned without an error\n";
+						ok = false;
+					}
+					continue;
+				}
+				const Expected& expected = files[size_t(file_of_path[p])];
+				if (metadata.error != tiff::Error::NoError || metadata.width != expected.width || metadata.height != expected.height
+					|| metadata.bits_per_sample != expected.bits_per_sample || metadata.samples_per_pixel != expected.samples_per_pixel
+					|| metadata.file_size != std::filesystem::file_size(paths[p]) || metadata.description != paths[p].filename().string())
+				{
+					std::cerr << name << ": " << paths[p] << " was scanned wrong\n";
+					ok = false;
+				}
+				if (metadata.frame_count != (count_frames ? expected.frames : 0))
+				{
+					std::cerr << name << ": " << paths[p] << " has " << metadata.frame_count << " frames\n";
+					ok = false;
+				}
+			}
+		}
+	}
+
+	if (!tiff::reader::scan_metadata({}, true, 4).empty())
+	{
+		std::cerr << "scanning no paths gave results\n";
+		ok = false;
+	}
+
+	for (const auto& path : paths)
+	{
+		std::error_code ec{};
+		std::filesystem::remove(path, ec);
+	}
+	if (ok)
+	{
+		std::cout << "scanned metadata in order\n";
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,124 @@
+#include "tiff_cxx.h"
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <limits>
+#include <iostream>
+#include <filesystem>
+#include <type_traits>
+
+// statistics gathered while reading regions are compared to values worked out by hand, float frames
+// with NaNs (the first sample too) and an integer frame, both split in strips so that bands add up
+
+struct Expected
+{
+	double min;
+	double max;
+	double sum;
+	double sum_of_squares;
+	uint64_t count;
+	uint64_t nan_count;
+	std::vector<uint64_t> histogram;
+};
+
+template<typename value_t>
+static bool write_file(const std::filesystem::path& path, uint32_t width, uint32_t height, const std::vector<value_t>& pixels)
+{
+	tiff::writer::FrameInfo info{};
+	info.width = width;
+	info.height = height;
+	info.bits_per_sample = sizeof(value_t) * 8;
+	info.samples_per_pixel = 1;
+	info.sample_format = std::is_floating_point_v<value_t> ? tiff::SampleFormat::Float : tiff::SampleFormat::Uint;
+	info.rows_per_strip = 2;
+
+	tiff::writer::Writer writer{ path };
+	return writer.open() == tiff::Error::NoError && writer.write_frame(info, pixels.data()) == tiff::Error::NoError
+		&& writer.close() == tiff::Error::NoError;
+}
+
+template<typename value_t>
+static bool check(const std::filesystem::path& path, const std::string& name, const tiff::Rect& region, const Expected& expected)
+{
+	tiff::reader::Reader reader{ path };
+	if (reader.open() != tiff::Error::NoError)
+	{
+		std::cerr << name << ": open failed\n";
+		return false;
+	}
+	tiff::SampleStatistics stats{};
+	stats.histogram_min = 0.0;
+	stats.histogram_max = 10.0;
+	stats.histogram.resize(5);
+	std::vector<value_t> buffer(size_t(region.width) * region.height);
+	if (reader.read_region(0, 0, region, buffer.data(), buffer.size() * sizeof(value_t), &stats) != tiff::Error::NoError)
+	{
+		std::cerr << name << ": read_region failed\n";
+		return false;
+	}
+	if (stats.count != expected.count || stats.nan_count != expected.nan_count)
+	{
+		std::cerr << name << ": " << stats.count << " samples and " << stats.nan_count << " NaNs\n";
+		return false;
+	}
+	// an all NaN region has no minimum or maximum to compare
+	if (expected.count != 0 && (stats.min != expected.min || stats.max != expected.max))
+	{
+		std::cerr << name << ": the range is [" << stats.min << ", " << stats.max << "]\n";
+		return false;
+	}
+	if (stats.sum != expected.sum || stats.sum_of_squares != expected.sum_of_squares)
+	{
+		std::cerr << name << ": the sum is " << stats.sum << " and the sum of squares " << stats.sum_of_squares << "\n";
+		return false;
+	}
+	if (stats.histogram != expected.histogram)
+	{
+		std::cerr << name << ": the histogram is wrong\n";
+		return false;
+	}
+	return true;
+}
+
+int main()
+{
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "tinytiff_cxx_statistics.tif";
+	bool ok = true;
+
+	// the NaNs open the first and the second strip, 12 is above the histogram and -1 below it
+	const float nan = std::numeric_limits<float>::quiet_NaN();
+	const std::vector<float> floats{
+		nan, 2.5f, -1.0f,
+		4.0f, 9.5f, 12.0f,
+		nan, 0.0f, 3.0f,
+		7.25f, 5.0f, 1.0f,
+	};
+	if (!write_file(path, 3, 4, floats))
+	{
+		std::cerr << "writing the float file failed\n";
+		return 1;
+	}
+	ok = check<float>(path, "float", tiff::Rect{ 0, 0, 3, 4 }, { -1.0, 12.0, 43.25, 345.0625, 10, 2, { 3, 2, 2, 1, 2 } }) && ok;
+	ok = check<float>(path, "float column", tiff::Rect{ 0, 0, 1, 4 }, { 4.0, 7.25, 11.25, 68.5625, 2, 2, { 0, 0, 1, 1, 0 } }) && ok;
+	ok = check<float>(path, "NaN only", tiff::Rect{ 0, 0, 1, 1 }, { 0.0, 0.0, 0.0, 0.0, 0, 1, { 0, 0, 0, 0, 0 } }) && ok;
+
+	const std::vector<uint16_t> integers{
+		3, 1, 4,
+		1, 5, 9,
+	};
+	if (!write_file(path, 3, 2, integers))
+	{
+		std::cerr << "writing the integer file failed\n";
+		return 1;
+	}
+	ok = check<uint16_t>(path, "uint16", tiff::Rect{ 0, 0, 3, 2 }, { 1.0, 9.0, 23.0, 133.0, 6, 0, { 2, 1, 2, 0, 1 } }) && ok;
+
+	std::error_code ec{};
+	std::filesystem::remove(path, ec);
+	if (ok)
+	{
+		std::cout << "statistics match\n";
+	}
+	return ok ? 0 : 1;
+}
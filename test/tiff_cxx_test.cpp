@@ -43,7 +43,14 @@ int main()
 		<< "resolution unit = " << (int)reader.resolution_unit() << "\n"
 		<< "bits_per_sample = " << reader.bits_per_sample() << "\n"
 		<< "sample_per_pixel = " << reader.samples_per_pixel() << "\n"
-		<< "sample_format = " << (int)reader.sameple_format() << "\n";
+		<< "sample_format = " << (int)reader.sameple_format() << "\n"
+		<< "count_levels = " << reader.count_levels() << "\n";
+
+	for (uint32_t level = 1; level < reader.count_levels(); ++level)
+	{
+		auto size = reader.level_size(level);
+		std::cout << "\tlevel " << level << " = " << size.x << " x " << size.y << "\n";
+	}
 
 	std::cout << std::endl;
 
@@ -0,0 +1,211 @@
+#include "tiff_cxx.h"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <filesystem>
+
+// files written in strips, in tiles and with SubIFD or chained pyramids are read back and compared
+// pixel by pixel, the levels (picked by their size) against the top left pixel of their blocks (Downsampling::Nearest)
+
+static uint16_t sample_value(uint32_t x, uint32_t y, uint32_t c, uint32_t frame)
+{
+	return uint16_t(x * 31 + y * 17 + c * 7 + frame * 1001);
+}
+
+static std::vector<uint16_t> make_frame(uint32_t width, uint32_t height, uint16_t samples, uint32_t frame)
+{
+	std::vector<uint16_t> pixels(size_t(width) * height * samples);
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			for (uint16_t c = 0; c < samples; ++c)
+			{
+				pixels[(size_t(y) * width + x) * samples + c] = sample_value(x, y, c, frame);
+			}
+		}
+	}
+	return pixels;
+}
+
+static bool check(const std::filesystem::path& path, const tiff::writer::FrameInfo& info, uint32_t frames)
+{
+	const std::string name = path.filename().string();
+
+	tiff::writer::Writer writer{ path };
+	if (writer.open() != tiff::Error::NoError)
+	{
+		std::cerr << name << ": open for writing failed\n";
+		return false;
+	}
+	for (uint32_t frame = 0; frame < frames; ++frame)
+	{
+		const std::vector<uint16_t> pixels = make_frame(info.width, info.height, info.samples_per_pixel, frame);
+		// the first frame goes in one call, the others in uneven row batches
+		if (frame == 0)
+		{
+			if (writer.write_frame(info, pixels.data()) != tiff::Error::NoError)
+			{
+				std::cerr << name << ": write_frame failed\n";
+				return false;
+			}
+			continue;
+		}
+		if (writer.begin_frame(info) != tiff::Error::NoError)
+		{
+			std::cerr << name << ": begin_frame failed\n";
+			return false;
+		}
+		for (uint32_t y = 0; y < info.height; y += 7)
+		{
+			const uint32_t rows = std::min(7u, info.height - y);
+			if (writer.write_rows(&pixels[size_t(y) * info.width * info.samples_per_pixel], rows) != tiff::Error::NoError)
+			{
+				std::cerr << name << ": write_rows failed\n";
+				return false;
+			}
+		}
+		if (writer.end_frame() != tiff::Error::NoError)
+		{
+			std::cerr << name << ": end_frame failed\n";
+			return false;
+		}
+	}
+	if (writer.close() != tiff::Error::NoError)
+	{
+		std::cerr << name << ": close failed\n";
+		return false;
+	}
+
+	tiff::reader::Reader reader{ path };
+	if (reader.open() != tiff::Error::NoError)
+	{
+		std::cerr << name << ": open for reading failed\n";
+		return false;
+	}
+	if (reader.count_frames() != frames)
+	{
+		std::cerr << name << ": " << reader.count_frames() << " frames instead of " << frames << "\n";
+		return false;
+	}
+	for (uint32_t frame = 0; frame < frames; ++frame)
+	{
+		if (frame != 0 && reader.read_next_frame() != tiff::Error::NoError)
+		{
+			std::cerr << name << ": read_next_frame failed\n";
+			return false;
+		}
+		if (reader.width() != info.width || reader.height() != info.height || reader.bits_per_sample() != 16
+			|| reader.samples_per_pixel() != info.samples_per_pixel)
+		{
+			std::cerr << name << ": frame " << frame << " has the wrong geometry\n";
+			return false;
+		}
+		if (reader.count_levels() != info.pyramid_levels + 1)
+		{
+			std::cerr << name << ": frame " << frame << " has " << reader.count_levels() << " levels\n";
+			return false;
+		}
+		for (uint32_t expected = 0; expected <= info.pyramid_levels; ++expected)
+		{
+			// the smallest level covering a size is picked, one pixel more needs the level above
+			const uint32_t level_width = ((info.width - 1) >> expected) + 1;
+			const uint32_t level_height = ((info.height - 1) >> expected) + 1;
+			const uint32_t level = reader.select_level(level_width, level_height);
+			if (level != expected || (expected != 0 && reader.select_level(level_width + 1, level_height) != expected - 1))
+			{
+				std::cerr << name << ": selected level " << level << " for level " << expected << "\n";
+				return false;
+			}
+			const tiff::Vec2ul size = reader.level_size(level);
+			if (size.x != level_width || size.y != level_height)
+			{
+				std::cerr << name << ": level " << level << " is " << size.x << "x" << size.y << "\n";
+				return false;
+			}
+			std::vector<uint16_t> buffer(size_t(size.x) * size.y);
+			for (uint16_t c = 0; c < info.samples_per_pixel; ++c)
+			{
+				const tiff::Rect region{ 0, 0, uint32_t(size.x), uint32_t(size.y) };
+				if (reader.read_region(level, c, region, buffer.data(), buffer.size() * 2) != tiff::Error::NoError)
+				{
+					std::cerr << name << ": read_region failed on level " << level << "\n";
+					return false;
+				}
+				for (uint32_t y = 0; y < size.y; ++y)
+				{
+					for (uint32_t x = 0; x < size.x; ++x)
+					{
+						if (buffer[size_t(y) * size.x + x] != sample_value(x << level, y << level, c, frame))
+						{
+							std::cerr << name << ": frame " << frame << " level " << level << " sample " << c
+								<< " is wrong at " << x << ", " << y << "\n";
+							return false;
+						}
+					}
+				}
+			}
+		}
+
+		uint16_t sample = 0;
+		if (reader.level_size(info.pyramid_levels + 1).x != 0
+			|| reader.read_region(info.pyramid_levels + 1, 0, tiff::Rect{ 0, 0, 1, 1 }, &sample, sizeof(sample)) != tiff::Error::LevelNotFound)
+		{
+			std::cerr << name << ": a level below the smallest one was found\n";
+			return false;
+		}
+	}
+	return true;
+}
+
+int main()
+{
+	const std::filesystem::path dir = std::filesystem::temp_directory_path();
+	bool ok = true;
+
+	tiff::writer::FrameInfo info{};
+	info.width = 203;
+	info.height = 157;
+	info.bits_per_sample = 16;
+	info.samples_per_pixel = 2;
+	info.downsampling = tiff::writer::Downsampling::Nearest;
+
+	info.rows_per_strip = 10;
+	ok = check(dir / "tinytiff_cxx_writer_strips.tif", info, 3) && ok;
+
+	info.tile_width = 32;
+	info.tile_length = 48;
+	ok = check(dir / "tinytiff_cxx_writer_tiles.tif", info, 3) && ok;
+
+	info.pyramid_levels = 3;
+	info.pyramid_storage = tiff::writer::PyramidStorage::SubIFD;
+	ok = check(dir / "tinytiff_cxx_writer_subifd.tif", info, 2) && ok;
+
+	info.tile_width = 0;
+	info.tile_length = 0;
+	info.pyramid_storage = tiff::writer::PyramidStorage::Chained;
+	ok = check(dir / "tinytiff_cxx_writer_chained.tif", info, 2) && ok;
+
+	// no frame, no file
+	const std::filesystem::path empty = dir / "tinytiff_cxx_writer_empty.tif";
+	tiff::writer::Writer writer{ empty };
+	if (writer.open() != tiff::Error::NoError || writer.close() != tiff::Error::FrameIsNotComplete
+		|| std::filesystem::exists(empty))
+	{
+		std::cerr << "closing a writer without frames did not fail and remove the file\n";
+		ok = false;
+	}
+
+	for (const char* name : { "strips", "tiles", "subifd", "chained" })
+	{
+		std::error_code ec{};
+		std::filesystem::remove(dir / (std::string("tinytiff_cxx_writer_") + name + ".tif"), ec);
+	}
+	if (ok)
+	{
+		std::cout << "written files read back\n";
+	}
+	return ok ? 0 : 1;
+}
@@ -2,6 +2,18 @@
 
 #include <optional>
 #include <limits>
+#include <cstring>
+#include <type_traits>
+#include <algorithm>
+#include <future>
+#include <system_error>
+#include <new>
+#include <chrono>
+#include <thread>
+#include <iterator>
+#include <atomic>
+#include <cmath>
+#include <utility>
 
 #ifdef _WIN32
 #define tiff_memcpy_s(dest, dest_size, src, count) memcpy_s((dest), (dest_size), (src), (count))
@@ -11,6 +23,73 @@
 
 #endif
 
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define TIFF_CXX_HAS_IO_URING 1
+#endif
+#endif
+
+#ifndef TIFF_CXX_HAS_IO_URING
+#define TIFF_CXX_HAS_IO_URING 0
+#endif
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#endif
+
+#if TIFF_CXX_HAS_IO_URING
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+#if !defined(_WIN32) && defined(O_DIRECT)
+#define TIFF_CXX_HAS_DIRECT_IO 1
+#else
+#define TIFF_CXX_HAS_DIRECT_IO 0
+#endif
+
+// half floats are widened with F16C, picked at run time with GCC and Clang and by /arch:AVX2 with MSVC.
+// defining TIFF_CXX_HAS_F16C as 0 keeps the portable conversion
+#ifndef TIFF_CXX_HAS_F16C
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define TIFF_CXX_HAS_F16C 1
+#elif defined(_MSC_VER) && defined(__AVX2__)
+#define TIFF_CXX_HAS_F16C 1
+#else
+#define TIFF_CXX_HAS_F16C 0
+#endif
+#endif
+
+#if TIFF_CXX_HAS_F16C
+#if defined(__GNUC__) || defined(__clang__)
+#define TIFF_CXX_TARGET_F16C __attribute__((target("avx,f16c")))
+#else
+#define TIFF_CXX_TARGET_F16C
+#endif
+#include <immintrin.h>
+#endif
+
+// the sample kernels are also built for AVX2 and the loader picks the build matching the CPU, where GCC can do that
+#if defined(__linux__) && (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && !defined(__clang__)
+#define TIFF_CXX_KERNEL __attribute__((target_clones("avx2", "default")))
+#else
+#define TIFF_CXX_KERNEL
+#endif
+
 namespace tiff
 {
 	enum class ByteOrder : uint8_t
@@ -32,7 +111,8 @@ namespace tiff
 		ASCII = 2,
 		Short = 3,
 		Long = 4,
-		Rational = 5
+		Rational = 5,
+		IFD = 13,
 	};
 
 	enum class CompressionType : uint16_t
@@ -42,11 +122,6 @@ namespace tiff
 		PackBits = 32773,
 	};
 
-	enum class Orientation : uint8_t
-	{
-		Stantard = 1
-	};
-
 	enum class ExtraSamples : uint16_t
 	{
 		Unspecified = 0,
@@ -83,6 +158,7 @@ namespace tiff
 	// tiff tags: https://www.loc.gov/preservation/digital/formats/content/tiff_tags.shtml
 	enum class Tags : uint16_t
 	{
+		NewSubfileType = 254,
 		ImageWidth = 256,
 		ImageLength = 257,
 		BitsPerSample = 258,
@@ -99,12 +175,23 @@ namespace tiff
 		YResolution = 283,
 		PlanarConfig = 284,
 		ResolutionUnit = 296,
+		ColorMap = 320,
 		TileWidth = 322,
 		TileLength = 323,
 		TileOffsets = 324,
 		TileByteCounts = 325,
+		SubIFDs = 330,
 		ExtraSamples = 338,
 		SampleFormat = 339,
+		YCbCrSubSampling = 530,
+	};
+
+	enum class SubfileType : uint32_t
+	{
+		Default = 0,
+		ReducedResolution = 1,
+		Page = 2,
+		Mask = 4,
 	};
 
 	namespace util
@@ -124,18 +211,6 @@ namespace tiff
 			return ByteOrder::Unknown;
 		}
 
-		static std::optional<Vec2ul> do_ranges_overlap(const Vec2ul& r1, const Vec2ul& r2)
-		{
-			unsigned long total_range = std::max(r1.y, r2.y) - std::min(r1.x, r2.x);
-			unsigned long sum_of_ranges = (r1.y - r1.x) + (r2.y - r2.x);
-			if (sum_of_ranges > total_range)
-			{
-				Vec2ul result{ std::max(r1.x, r2.x), std::min(r1.y, r2.y) };
-				return result;
-			}
-			return {};
-		}
-
 		template<typename value_t>
 		static value_t byte_swap(value_t n) { return n; }
 
@@ -166,624 +241,5058 @@ namespace tiff
 		{
 			return ((n >> 8) | (n << 8));
 		}
-	}
 
-	namespace reader
-	{
-		struct ReaderFrame
+		// calls func with a value of the type matching the sample layout, false if there is no such type
+		template<typename func_t>
+		static bool visit_sample_type(uint32_t bits_per_sample, SampleFormat format, func_t&& func)
 		{
-			uint32_t width = 0;
-			uint32_t height = 0;
-			CompressionType compression = CompressionType::None;
+			if (format == SampleFormat::Float)
+			{
+				switch (bits_per_sample)
+				{
+				case 32: func(float{}); return true;
+				case 64: func(double{}); return true;
+				default: return false;
+				}
+			}
+			if (format == SampleFormat::Int)
+			{
+				switch (bits_per_sample)
+				{
+				case 8: func(int8_t{}); return true;
+				case 16: func(int16_t{}); return true;
+				case 32: func(int32_t{}); return true;
+				case 64: func(int64_t{}); return true;
+				default: return false;
+				}
+			}
+			switch (bits_per_sample)
+			{
+			case 8: func(uint8_t{}); return true;
+			case 16: func(uint16_t{}); return true;
+			case 32: func(uint32_t{}); return true;
+			case 64: func(uint64_t{}); return true;
+			default: return false;
+			}
+		}
 
-			uint16_t samples_per_pixel = 1;
-			uint32_t bits_per_sample = 0;
-			PlanarConfiguration planar_config = PlanarConfiguration::Chunky;
-			SampleFormat sample_format = SampleFormat::Uint;
+		// packed depths are widened to the next of 8, 16 or 32 bits while decoding, 0 for depths that can't be read
+		static uint32_t decoded_bits(uint32_t bits_per_sample)
+		{
+			if (bits_per_sample == 0 || (bits_per_sample > 32 && bits_per_sample != 64))
+			{
+				return 0;
+			}
+			return bits_per_sample <= 8 ? 8 : bits_per_sample <= 16 ? 16 : bits_per_sample <= 32 ? 32 : 64;
+		}
 
-			uint32_t image_length = 0;
-			Orientation orientation = Orientation::Stantard;
-			FillOrder fill_order = FillOrder::Default;
+		static float half_to_float(uint16_t h)
+		{
+			const uint32_t sign = uint32_t(h & 0x8000) << 16;
+			uint32_t exponent = (h >> 10) & 0x1F;
+			uint32_t mantissa = h & 0x3FF;
+			uint32_t bits = 0;
+			if (exponent == 0x1F)
+			{
+				// NaNs come out quiet, as F16C makes them
+				bits = sign | 0x7F800000 | (mantissa << 13) | (mantissa != 0 ? 0x00400000 : 0);
+			}
+			else if (exponent != 0)
+			{
+				bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+			}
+			else if (mantissa == 0)
+			{
+				bits = sign;
+			}
+			else
+			{
+				// subnormal halves are normal floats
+				exponent = 113;
+				while ((mantissa & 0x400) == 0)
+				{
+					mantissa <<= 1;
+					--exponent;
+				}
+				bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+			}
+			float result = 0.0f;
+			std::memcpy(&result, &bits, sizeof(result));
+			return result;
+		}
 
-			ResolutionUnit resolution_unit = ResolutionUnit::None;
-			Vec2f resolution{ 1.0f, 1.0f };
+#if TIFF_CXX_HAS_F16C
+		TIFF_CXX_TARGET_F16C static void half_to_float_f16c(const uint16_t* src, float* dst, size_t count)
+		{
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8)
+			{
+				_mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(src + i))));
+			}
+			for (; i < count; ++i)
+			{
+				dst[i] = half_to_float(src[i]);
+			}
+		}
 
-			PhotometricInterpretation photometric_interpertation = PhotometricInterpretation::BlackIsZero;
-			bool is_tiled = false;
+		static bool has_f16c()
+		{
+#if defined(__GNUC__) || defined(__clang__)
+			static const bool supported = __builtin_cpu_supports("f16c");
+			return supported;
+#else
+			return true;
+#endif
+		}
+#endif
 
-			uint32_t rows_per_strip = 0;
-			uint32_t strip_count = 0;
-			std::vector<uint32_t> strip_offsets{};
-			std::vector<uint32_t> strip_byte_counts{};
+		static void half_to_float(const uint16_t* src, float* dst, size_t count)
+		{
+#if TIFF_CXX_HAS_F16C
+			if (has_f16c())
+			{
+				half_to_float_f16c(src, dst, count);
+				return;
+			}
+#endif
+			for (size_t i = 0; i < count; ++i)
+			{
+				dst[i] = half_to_float(src[i]);
+			}
+		}
 
-			std::string description{};
-		};
+		// copies `count` samples lying `stride` samples apart (src_stride bytes when stride is 0), byte swapped with `swap`.
+		// one instance per sample size, byte order and chunky sample count keeps the loop free of branches
+		template<typename value_t, bool swap, uint32_t stride>
+		TIFF_CXX_KERNEL static void extract_kernel(const uint8_t* src, uint8_t* dst, uint32_t count, uint32_t src_stride)
+		{
+			if constexpr (!swap && stride == 1)
+			{
+				tiff_memcpy_s(dst, static_cast<size_t>(count) * sizeof(value_t), src, static_cast<size_t>(count) * sizeof(value_t));
+			}
+			else
+			{
+				const size_t step = (stride != 0) ? stride * sizeof(value_t) : src_stride;
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					value_t v{};
+					std::memcpy(&v, src + i * step, sizeof(value_t));
+					if constexpr (swap)
+					{
+						v = byte_swap(v);
+					}
+					std::memcpy(dst + static_cast<size_t>(i) * sizeof(value_t), &v, sizeof(value_t));
+				}
+			}
+		}
 
-		struct ReaderFile
+		typedef void (*extract_samples_t)(const uint8_t* src, uint8_t* dst, uint32_t count, uint32_t src_stride);
+
+		template<typename value_t, bool swap>
+		static extract_samples_t pick_extract_typed(uint32_t stride)
 		{
-			uint32_t first_record_offset = 0;
-			uint32_t next_ifd_offset = 0;
+			switch (stride)
+			{
+			case 1: return &extract_kernel<value_t, swap, 1>;
+			case 2: return &extract_kernel<value_t, swap, 2>;
+			case 3: return &extract_kernel<value_t, swap, 3>;
+			case 4: return &extract_kernel<value_t, swap, 4>;
+			default: return &extract_kernel<value_t, swap, 0>;
+			}
+		}
 
-			ByteOrder system_byte_order = ByteOrder::Unknown;
-			ByteOrder file_byte_order = ByteOrder::Unknown;
+		// the kernel for whole samples of `bytes_per_sample`, `stride` samples apart
+		static extract_samples_t pick_extract(uint32_t bytes_per_sample, uint32_t stride, bool swap)
+		{
+			switch (bytes_per_sample)
+			{
+			case 1: return pick_extract_typed<uint8_t, false>(stride);
+			case 2: return swap ? pick_extract_typed<uint16_t, true>(stride) : pick_extract_typed<uint16_t, false>(stride);
+			case 4: return swap ? pick_extract_typed<uint32_t, true>(stride) : pick_extract_typed<uint32_t, false>(stride);
+			case 8: return swap ? pick_extract_typed<uint64_t, true>(stride) : pick_extract_typed<uint64_t, false>(stride);
+			default: return nullptr;
+			}
+		}
 
-			uint64_t size = 0;
+		// looks palette indices up in one channel of the color map, the avx2 clone turns the loop into gathers
+		template<typename index_t>
+		TIFF_CXX_KERNEL static void expand_palette(const index_t* indices, const uint16_t* channel, uint16_t* dst, uint32_t count)
+		{
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				dst[i] = channel[indices[i]];
+			}
+		}
 
-			ReaderFrame current_frame{};
+		template<typename value_t>
+		TIFF_CXX_KERNEL static void place_kernel(const value_t* src, uint32_t cols, uint32_t rows, value_t* dst, ptrdiff_t col_step, ptrdiff_t row_step)
+		{
+			if (col_step == 1)
+			{
+				for (uint32_t j = 0; j < rows; ++j)
+				{
+					std::memcpy(dst + j * row_step, src + static_cast<size_t>(j) * cols, cols * sizeof(value_t));
+				}
+				return;
+			}
+			// reversed or interleaved rows, row by row while a row of dst lies closer together than a column
+			if ((col_step < 0 ? -col_step : col_step) < (row_step < 0 ? -row_step : row_step))
+			{
+				for (uint32_t j = 0; j < rows; ++j)
+				{
+					const value_t* s = src + static_cast<size_t>(j) * cols;
+					value_t* d = dst + j * row_step;
+					for (uint32_t i = 0; i < cols; ++i)
+					{
+						d[i * col_step] = s[i];
+					}
+				}
+				return;
+			}
+			// transposed, tile by tile so that the rows read and the rows written stay in cache.
+			// small tiles keep clear of the cache set conflicts power of two row sizes cause
+			constexpr uint32_t tile = 16;
+			for (uint32_t j0 = 0; j0 < rows; j0 += tile)
+			{
+				const uint32_t j1 = std::min(rows, j0 + tile);
+				for (uint32_t i0 = 0; i0 < cols; i0 += tile)
+				{
+					const uint32_t i1 = std::min(cols, i0 + tile);
+					for (uint32_t i = i0; i < i1; ++i)
+					{
+						value_t* d = dst + i * col_step;
+						for (uint32_t j = j0; j < j1; ++j)
+						{
+							d[j * row_step] = src[static_cast<size_t>(j) * cols + i];
+						}
+					}
+				}
+			}
+		}
 
-			std::ifstream stream{};
-		};
+		// copies `rows` rows of `cols` samples, sample i of row j goes to dst[i * col_step + j * row_step]
+		static void place_samples(uint32_t bytes_per_sample, const void* src, uint32_t cols, uint32_t rows, void* dst, ptrdiff_t col_step, ptrdiff_t row_step)
+		{
+			switch (bytes_per_sample)
+			{
+			case 1: place_kernel((const uint8_t*)src, cols, rows, (uint8_t*)dst, col_step, row_step); break;
+			case 2: place_kernel((const uint16_t*)src, cols, rows, (uint16_t*)dst, col_step, row_step); break;
+			case 4: place_kernel((const uint32_t*)src, cols, rows, (uint32_t*)dst, col_step, row_step); break;
+			case 8: place_kernel((const uint64_t*)src, cols, rows, (uint64_t*)dst, col_step, row_step); break;
+			default: break;
+			}
+		}
 
-		// Image File Directory
-		struct IFD
+		// mirrors a row of samples in place
+		static void reverse_samples(uint32_t bytes_per_sample, void* row, uint32_t count)
 		{
-			Tags tag = Tags::ImageWidth;
-			DataType type = DataType::Byte;
-			uint32_t count = 0;
-			uint32_t value = 0;
-			uint32_t value2 = 0;
+			switch (bytes_per_sample)
+			{
+			case 1: std::reverse((uint8_t*)row, (uint8_t*)row + count); break;
+			case 2: std::reverse((uint16_t*)row, (uint16_t*)row + count); break;
+			case 4: std::reverse((uint32_t*)row, (uint32_t*)row + count); break;
+			case 8: std::reverse((uint64_t*)row, (uint64_t*)row + count); break;
+			default: break;
+			}
+		}
 
-			std::vector<uint32_t> pvalue{};
-			std::vector<uint32_t> pvalue2{};
-		};
+		// max - v for WhiteIsZero samples of `bits` widened to value_t
+		template<typename value_t>
+		TIFF_CXX_KERNEL static void invert_samples(value_t* samples, uint32_t count, uint32_t bits)
+		{
+			const value_t max = value_t((uint32_t(1) << bits) - 1);
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				samples[i] = value_t(max - samples[i]);
+			}
+		}
 
-		struct ReaderPrivate
+		// one of red, green and blue, y + cb_factor * (cb - half) + cr_factor * (cr - half) rounded and clamped to the depth
+		template<typename value_t>
+		TIFF_CXX_KERNEL static void ycbcr_to_rgb(const value_t* y, const value_t* cb, const value_t* cr, value_t* dst, uint32_t count,
+			float cb_factor, float cr_factor, uint32_t bits)
 		{
-			std::filesystem::path tiff_path{};
-			ReaderFile file{};
-			std::string last_error{};
-			bool good = false;
+			const float max = float((uint32_t(1) << bits) - 1);
+			const float half = float(uint32_t(1) << (bits - 1));
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				const float v = float(y[i]) + cb_factor * (float(cb[i]) - half) + cr_factor * (float(cr[i]) - half);
+				dst[i] = value_t(std::min(std::max(v, 0.0f), max) + 0.5f);
+			}
+		}
 
-			template<typename value_t>
-			value_t byte_swap_if_need(value_t n) const noexcept
+		// one of red, green and blue, (max - ink) * (max - black) / max rounded
+		template<typename value_t>
+		TIFF_CXX_KERNEL static void cmyk_to_rgb(const value_t* ink, const value_t* black, value_t* dst, uint32_t count, uint32_t bits)
+		{
+			const float max = float((uint32_t(1) << bits) - 1);
+			const float inverse = 1.0f / max;
+			for (uint32_t i = 0; i < count; ++i)
 			{
-				if (file.system_byte_order != file.file_byte_order)
+				dst[i] = value_t((max - float(ink[i])) * (max - float(black[i])) * inverse + 0.5f);
+			}
+		}
+
+		// the values a sample of this depth holds, [0, 1] for floats
+		static std::pair<double, double> sample_range(uint32_t bits_per_sample, SampleFormat format)
+		{
+			if (format == SampleFormat::Float)
+			{
+				return { 0.0, 1.0 };
+			}
+			if (format == SampleFormat::Int)
+			{
+				const double half = std::ldexp(1.0, int(bits_per_sample) - 1);
+				return { -half, half - 1.0 };
+			}
+			return { 0.0, std::ldexp(1.0, int(bits_per_sample)) - 1.0 };
+		}
+
+		// out = in * scale + offset, integer outputs are rounded to nearest and saturated (NaN gives 0).
+		// samples up to 16 bits going to float or to 8 and 16 bit integers are computed in float, which vectorizes wider
+		template<typename in_t, typename out_t>
+		TIFF_CXX_KERNEL static void convert_samples(const void* src, void* dst, size_t count, double scale, double offset)
+		{
+			typedef std::conditional_t<(sizeof(in_t) <= 2 && !std::is_same_v<out_t, double> && (std::is_floating_point_v<out_t> || sizeof(out_t) <= 2)),
+				float, double> acc_t;
+			const in_t* in = (const in_t*)src;
+			out_t* out = (out_t*)dst;
+			if constexpr (std::is_same_v<in_t, out_t>)
+			{
+				if (scale == 1.0 && offset == 0.0)
 				{
-					return util::byte_swap(n);
+					std::memcpy(out, in, count * sizeof(out_t));
+					return;
 				}
-				return n;
 			}
-
-			template<typename value_t>
-			value_t read()
+			const acc_t a = acc_t(scale);
+			const acc_t b = acc_t(offset);
+			if constexpr (std::is_floating_point_v<out_t>)
 			{
-				value_t result{};
-				if (file.stream.good())
+				for (size_t i = 0; i < count; ++i)
 				{
-					file.stream.read((char*)(&result), sizeof(result));
-					result = byte_swap_if_need(result);
+					out[i] = out_t(acc_t(in[i]) * a + b);
+				}
+			}
+			else
+			{
+				const acc_t lowest = acc_t(std::numeric_limits<out_t>::lowest());
+				const acc_t highest = acc_t(std::numeric_limits<out_t>::max());
+				for (size_t i = 0; i < count; ++i)
+				{
+					const acc_t v = acc_t(in[i]) * a + b;
+					out[i] = (v >= highest) ? std::numeric_limits<out_t>::max()
+						: (v <= lowest) ? std::numeric_limits<out_t>::lowest()
+						: (v == v) ? out_t(v + (v < 0 ? acc_t(-0.5) : acc_t(0.5))) : out_t(0);
 				}
-				return result;
 			}
+		}
 
-			IFD read_ifd()
+		typedef void (*convert_samples_t)(const void* src, void* dst, size_t count, double scale, double offset);
+
+		static convert_samples_t pick_conversion(uint32_t in_bits, SampleFormat in_format, uint32_t out_bits, SampleFormat out_format)
+		{
+			convert_samples_t result = nullptr;
+			visit_sample_type(in_bits, in_format, [&](auto in)
 			{
-				IFD d{};
+				visit_sample_type(out_bits, out_format, [&](auto out)
+				{
+					result = &convert_samples<decltype(in), decltype(out)>;
+				});
+			});
+			return result;
+		}
 
-				d.tag = Tags(read<uint16_t>());
-				d.type = DataType(read<uint16_t>());
-				d.count = read<uint32_t>();
+		static uint8_t reverse_bits(uint8_t n)
+		{
+			n = uint8_t((n >> 4) | (n << 4));
+			n = uint8_t(((n & 0xCC) >> 2) | ((n & 0x33) << 2));
+			return uint8_t(((n & 0xAA) >> 1) | ((n & 0x55) << 1));
+		}
 
-				std::streampos pos = file.stream.tellg();
-				bool pos_changed = false;
+		// reverse_bits on each byte of a word at once
+		static uint64_t reverse_bits_of_bytes(uint64_t n)
+		{
+			n = ((n & 0xF0F0F0F0F0F0F0F0ULL) >> 4) | ((n & 0x0F0F0F0F0F0F0F0FULL) << 4);
+			n = ((n & 0xCCCCCCCCCCCCCCCCULL) >> 2) | ((n & 0x3333333333333333ULL) << 2);
+			return ((n & 0xAAAAAAAAAAAAAAAAULL) >> 1) | ((n & 0x5555555555555555ULL) << 1);
+		}
 
-				switch (d.type)
-				{
-				case DataType::Byte:
-				case DataType::ASCII:
+		// the 1, 2 or 4 bit samples of every byte value, first sample in the high bits, for both fill orders
+		template<uint32_t bits>
+		struct SubByteTable
+		{
+			uint8_t values[2][256][8 / bits]{};
+		};
+
+		template<uint32_t bits>
+		static const SubByteTable<bits>& sub_byte_table()
+		{
+			static const SubByteTable<bits> table = []()
+			{
+				SubByteTable<bits> t{};
+				for (uint32_t reversed = 0; reversed < 2; ++reversed)
 				{
-					if (d.count > 0)
+					for (uint32_t n = 0; n < 256; ++n)
 					{
-						if (d.count <= 4)
+						const uint8_t byte = reversed ? reverse_bits(uint8_t(n)) : uint8_t(n);
+						for (uint32_t k = 0; k < 8 / bits; ++k)
 						{
-							for (int i = 0; i < 4; ++i)
-							{
-								uint32_t v = read<uint8_t>();
-								if (i < d.count) d.pvalue.emplace_back(v);
-							}
+							t.values[reversed][n][k] = uint8_t((byte >> (8 - bits * (k + 1))) & ((1u << bits) - 1));
 						}
-						else
-						{
-							pos_changed = true;
-							uint32_t offset = read<uint32_t>();
-							if (offset + static_cast<uint64_t>(d.count) * 1 <= file.size)
+					}
+				}
+				return t;
+			}();
+			return table;
+		}
+
+		// rounded mean of four samples without overflowing the sample type
+		template<typename value_t>
+		static value_t mean_of_4(value_t a, value_t b, value_t c, value_t d)
+		{
+			if constexpr (std::is_floating_point_v<value_t>)
+			{
+				return (a + b + c + d) * value_t(0.25);
+			}
+			else if constexpr (sizeof(value_t) <= 4)
+			{
+				typedef std::conditional_t<std::is_signed_v<value_t>, int64_t, uint64_t> acc_t;
+				acc_t sum = acc_t(a) + acc_t(b) + acc_t(c) + acc_t(d);
+				if constexpr (std::is_signed_v<value_t>)
+				{
+					return value_t((sum + (sum < 0 ? -2 : 2)) / 4);
+				}
+				else
+				{
+					return value_t((sum + 2) / 4);
+				}
+			}
+			else
+			{
+				value_t q = a / 4 + b / 4 + c / 4 + d / 4;
+				value_t r = a % 4 + b % 4 + c % 4 + d % 4;
+				if constexpr (std::is_signed_v<value_t>)
+				{
+					return q + (r + (r < 0 ? -2 : 2)) / 4;
+				}
+				else
+				{
+					return q + (r + 2) / 4;
+				}
+			}
+		}
+
+		template<typename value_t>
+		static void reset_statistics(SampleStatistics& stats)
+		{
+			stats.min = std::numeric_limits<double>::max();
+			stats.max = std::numeric_limits<double>::lowest();
+			stats.sum = 0.0;
+			stats.sum_of_squares = 0.0;
+			stats.count = 0;
+			stats.nan_count = 0;
+			std::fill(stats.histogram.begin(), stats.histogram.end(), uint64_t(0));
+			if (!(stats.histogram_min < stats.histogram_max))
+			{
+				if constexpr (std::is_floating_point_v<value_t>)
+				{
+					stats.histogram_min = 0.0;
+					stats.histogram_max = 1.0;
+				}
+				else
+				{
+					stats.histogram_min = double(std::numeric_limits<value_t>::lowest());
+					stats.histogram_max = double(std::numeric_limits<value_t>::max());
+				}
+			}
+		}
+
+		// one pass over samples which are still in cache right after decoding
+		template<typename value_t>
+		static void accumulate_statistics(const value_t* data, size_t count, SampleStatistics& stats)
+		{
+			if (count == 0)
+			{
+				return;
+			}
+
+			// narrow integers sum exactly in 64 bits, this keeps the min / max / sum loop free of conversions
+			typedef std::conditional_t<std::is_integral_v<value_t> && sizeof(value_t) <= 2,
+				std::conditional_t<std::is_signed_v<value_t>, int64_t, uint64_t>, double> acc_t;
+			acc_t sum = 0;
+			acc_t sum_of_squares = 0;
+			uint64_t nans = 0;
+			if constexpr (std::is_floating_point_v<value_t>)
+			{
+				// NaNs are only counted, std::min / std::max would keep one that came first
+				size_t first = 0;
+				while (first < count && std::isnan(data[first]))
+				{
+					++first;
+				}
+				nans = first;
+				if (first == count)
+				{
+					stats.nan_count += nans;
+					return;
+				}
+				value_t lo = data[first];
+				value_t hi = data[first];
+				for (size_t i = first; i < count; ++i)
+				{
+					const value_t v = data[i];
+					if (v != v)
+					{
+						++nans;
+						continue;
+					}
+					lo = std::min(lo, v);
+					hi = std::max(hi, v);
+					sum += acc_t(v);
+					sum_of_squares += acc_t(v) * acc_t(v);
+				}
+				stats.min = std::min(stats.min, double(lo));
+				stats.max = std::max(stats.max, double(hi));
+			}
+			else
+			{
+				value_t lo = data[0];
+				value_t hi = data[0];
+				for (size_t i = 0; i < count; ++i)
+				{
+					const value_t v = data[i];
+					lo = std::min(lo, v);
+					hi = std::max(hi, v);
+					sum += acc_t(v);
+					sum_of_squares += acc_t(v) * acc_t(v);
+				}
+				stats.min = std::min(stats.min, double(lo));
+				stats.max = std::max(stats.max, double(hi));
+			}
+			stats.sum += double(sum);
+			stats.sum_of_squares += double(sum_of_squares);
+			stats.count += count - nans;
+			stats.nan_count += nans;
+
+			if (!stats.histogram.empty())
+			{
+				const size_t bins = stats.histogram.size();
+				const double scale = double(bins) / (stats.histogram_max - stats.histogram_min);
+				const double last = double(bins - 1);
+				uint64_t* histogram = stats.histogram.data();
+				for (size_t i = 0; i < count; ++i)
+				{
+					// a NaN has no bin, converting it to an index is undefined
+					if constexpr (std::is_floating_point_v<value_t>)
+					{
+						if (std::isnan(data[i]))
+						{
+							continue;
+						}
+					}
+					const double bin = (double(data[i]) - stats.histogram_min) * scale;
+					histogram[static_cast<size_t>(std::min(std::max(bin, 0.0), last))] += 1;
+				}
+			}
+		}
+
+		template<typename value_t>
+		using sum_type_t = std::conditional_t<std::is_floating_point_v<value_t>, double,
+			std::conditional_t<std::is_signed_v<value_t>, int64_t, uint64_t>>;
+
+		// horizontal part of the binning, the bin width is a constant so that the inner loop is unrolled and vectorized
+		template<uint32_t factor_v, typename value_t>
+		static void bin_row_fixed(const value_t* row, uint32_t bins, sum_type_t<value_t>* sums, value_t* maxima, bool first)
+		{
+			typedef sum_type_t<value_t> sum_t;
+			if (sums != nullptr)
+			{
+				for (uint32_t x = 0; x < bins; ++x)
+				{
+					sum_t s = 0;
+					for (uint32_t i = 0; i < factor_v; ++i)
+					{
+						s += sum_t(row[x * factor_v + i]);
+					}
+					sums[x] = first ? s : sums[x] + s;
+				}
+			}
+			else
+			{
+				for (uint32_t x = 0; x < bins; ++x)
+				{
+					value_t m = first ? row[x * factor_v] : std::max(maxima[x], row[x * factor_v]);
+					for (uint32_t i = 1; i < factor_v; ++i)
+					{
+						m = std::max(m, row[x * factor_v + i]);
+					}
+					maxima[x] = m;
+				}
+			}
+		}
+
+		template<typename value_t>
+		static void bin_row_generic(const value_t* row, uint32_t bins, uint32_t factor, uint32_t width,
+			sum_type_t<value_t>* sums, value_t* maxima, bool first)
+		{
+			typedef sum_type_t<value_t> sum_t;
+			for (uint32_t x = 0; x < bins; ++x)
+			{
+				const uint32_t end = std::min(width, (x + 1) * factor);
+				sum_t s = 0;
+				value_t m = row[x * factor];
+				for (uint32_t i = x * factor; i < end; ++i)
+				{
+					s += sum_t(row[i]);
+					m = std::max(m, row[i]);
+				}
+				if (sums != nullptr)
+				{
+					sums[x] = first ? s : sums[x] + s;
+				}
+				else
+				{
+					maxima[x] = first ? m : std::max(maxima[x], m);
+				}
+			}
+		}
+
+		// sums or maxima of every `factor` wide bin of one row, either starting a new bin row or adding to it
+		template<typename value_t>
+		static void bin_row(const value_t* row, uint32_t width, uint32_t factor,
+			sum_type_t<value_t>* sums, value_t* maxima, bool first)
+		{
+			const uint32_t full_bins = width / factor;
+			switch (factor)
+			{
+			case 2: bin_row_fixed<2>(row, full_bins, sums, maxima, first); break;
+			case 4: bin_row_fixed<4>(row, full_bins, sums, maxima, first); break;
+			case 8: bin_row_fixed<8>(row, full_bins, sums, maxima, first); break;
+			default: bin_row_generic(row, full_bins, factor, width, sums, maxima, first); break;
+			}
+			if (full_bins * factor < width)
+			{
+				bin_row_generic(row + full_bins * factor, 1, factor, width - full_bins * factor,
+					sums != nullptr ? sums + full_bins : nullptr, maxima + full_bins, first);
+			}
+		}
+	}
+
+	namespace reader
+	{
+		// location of a strip or tile table in the file, the values start at data_offset
+		struct ReaderTable
+		{
+			DataType type = DataType::Long;
+			uint32_t count = 0;
+			uint64_t data_offset = 0;
+		};
+
+		struct ReaderFrame
+		{
+			uint32_t width = 0;
+			uint32_t height = 0;
+			CompressionType compression = CompressionType::None;
+
+			uint16_t samples_per_pixel = 1;
+			uint32_t bits_per_sample = 0;
+			PlanarConfiguration planar_config = PlanarConfiguration::Chunky;
+			SampleFormat sample_format = SampleFormat::Uint;
+
+			uint32_t image_length = 0;
+			Orientation orientation = Orientation::Stantard;
+			FillOrder fill_order = FillOrder::Default;
+
+			ResolutionUnit resolution_unit = ResolutionUnit::None;
+			Vec2f resolution{ 1.0f, 1.0f };
+
+			PhotometricInterpretation photometric_interpertation = PhotometricInterpretation::BlackIsZero;
+			bool is_tiled = false;
+
+			uint32_t rows_per_strip = 0;
+			uint32_t strip_count = 0;
+			std::vector<uint32_t> strip_offsets{};
+			std::vector<uint32_t> strip_byte_counts{};
+
+			uint32_t tile_width = 0;
+			uint32_t tile_length = 0;
+			std::vector<uint32_t> tile_offsets{};
+			std::vector<uint32_t> tile_byte_counts{};
+
+			// strip or tile tables, also filled when the tables themselves were not loaded
+			ReaderTable offsets_table{};
+			ReaderTable byte_counts_table{};
+			bool tables_loaded = false;
+
+			// palette images: all reds, then all greens, then all blues
+			ReaderTable color_map_table{};
+			std::vector<uint16_t> color_map{};
+
+			// YCbCr images: lumas across and down sharing one Cb, Cr pair
+			uint32_t ycbcr_subsampling_h = 2;
+			uint32_t ycbcr_subsampling_v = 2;
+
+			SubfileType subfile_type = SubfileType::Default;
+			std::vector<uint32_t> sub_ifds{};
+
+			std::string description{};
+		};
+
+		// one frame of the sidecar index, enough to locate its strips or tiles without reading the IFD
+		struct ReaderIndexEntry
+		{
+			uint32_t ifd_offset = 0;
+			uint32_t width = 0;
+			uint32_t height = 0;
+			uint32_t bits_per_sample = 0;
+			uint32_t samples_per_pixel = 0;
+			uint32_t sample_format = 0;
+			uint32_t planar_config = 0;
+			uint32_t compression = 0;
+			uint32_t photometric = 0;
+			uint32_t orientation = 0;
+			uint32_t fill_order = 0;
+			uint32_t is_tiled = 0;
+			uint32_t rows_per_strip = 0;
+			uint32_t tile_width = 0;
+			uint32_t tile_length = 0;
+			ReaderTable offsets_table{};
+			ReaderTable byte_counts_table{};
+			ReaderTable color_map_table{};
+			uint32_t ycbcr_subsampling = 0;
+		};
+
+		// how a stored frame is displayed: rows and columns swapped, then mirrored across and down
+		struct ReaderOrientation
+		{
+			bool transpose = false;
+			bool flip_x = false;
+			bool flip_y = false;
+
+			bool identity() const noexcept { return !transpose && !flip_x && !flip_y; }
+		};
+
+		// what is done to the stored samples of a pixel to get the requested one, see Reader::set_convert_color
+		enum class ColorStage : uint8_t
+		{
+			None = 0,
+			Invert = 1, // WhiteIsZero to BlackIsZero
+			YCbCr = 2,  // one of red, green and blue from Y, Cb and Cr
+			CMYK = 3,   // one of red, green and blue from an ink and black
+		};
+
+		// where the samples of one plane live: a grid of tiles, or a single column of strips
+		struct ReaderBlockLayout
+		{
+			uint32_t block_width = 0;
+			uint32_t block_height = 0;
+			uint32_t blocks_across = 0;
+			uint32_t blocks_down = 0;
+			uint32_t first_block = 0;
+
+			// size of a sample written out, of the sample decoded before any conversion and of the
+			// sample as stored (palette indices, halves) once widened to whole bytes,
+			// bits of a sample and of a pixel (all samples when chunky, a whole unit when subsampled) in the file
+			uint32_t bytes_per_sample = 0;
+			uint32_t sample_bytes = 0;
+			uint32_t stored_bytes = 0;
+			uint32_t bits = 0;
+			uint32_t pixel_bits = 0;
+			uint32_t sample_bit_offset = 0;
+			// rows start on a byte, packed depths pad the last one. subsampled rows hold units of unit_height image rows
+			uint32_t row_bytes = 0;
+			uint32_t unit_width = 1;
+			uint32_t unit_height = 1;
+
+			// not whole native samples, these are unpacked from a bit stream
+			bool packed = false;
+			bool half_to_float = false;
+			bool fill_reversed = false;
+			bool is_signed = false;
+
+			// kernels picked once per frame: extract for whole samples (and the halves before widening), unpack for packed ones
+			util::extract_samples_t extract = nullptr;
+			void (*unpack)(const uint8_t* src, size_t src_bytes, uint64_t bit, uint8_t* dst, uint32_t count, const ReaderBlockLayout& layout) = nullptr;
+
+			// set when samples are converted after decoding
+			util::convert_samples_t convert = nullptr;
+			double scale = 1.0;
+			double offset = 0.0;
+
+			// the color map channel palette indices are looked up in, when they are expanded
+			const uint16_t* palette = nullptr;
+
+			// color conversion of the samples of a pixel: the ink or YCbCr coefficients of the channel written out
+			ColorStage color = ColorStage::None;
+			uint32_t color_ink = 0;
+			float cb_factor = 0.0f;
+			float cr_factor = 0.0f;
+
+			const std::vector<uint32_t>* offsets = nullptr;
+			const std::vector<uint32_t>* byte_counts = nullptr;
+		};
+
+		// some rows and columns of one strip or tile, read as a single byte range
+		struct ReaderBlock
+		{
+			uint64_t offset = 0;
+			uint32_t size = 0;
+			uint32_t span = 0;
+			// the span bytes, in the source itself when it holds them in memory, otherwise at buffer_offset of the read buffer
+			const uint8_t* data = nullptr;
+			size_t buffer_offset = 0;
+
+			uint32_t row_begin = 0;
+			uint32_t row_end = 0;
+			uint32_t col_begin = 0;
+			uint32_t col_end = 0;
+		};
+
+		struct ReaderFile
+		{
+			uint32_t first_record_offset = 0;
+			uint32_t next_ifd_offset = 0;
+
+			// IFD offsets of the frames found so far (reduced resolution IFDs are left out),
+			// walking the chain goes on from frame_ifds_next and stops when it is 0
+			std::vector<uint32_t> frame_ifds{};
+			uint32_t frame_ifds_next = 0;
+
+			// where the zero next IFD offsets that ended the two walks were read, follow mode reads them again
+			uint64_t next_ifd_field = 0;
+			uint64_t frame_ifds_next_field = 0;
+			uint64_t last_next_field = 0;
+
+			// layout of the indexed frames, only kept once a sidecar index was loaded or saved
+			std::vector<ReaderIndexEntry> frame_entries{};
+
+			ByteOrder system_byte_order = ByteOrder::Unknown;
+			ByteOrder file_byte_order = ByteOrder::Unknown;
+
+			uint64_t size = 0;
+
+			ReaderFrame current_frame{};
+			std::vector<ReaderFrame> current_levels{};
+
+			std::shared_ptr<ByteSource> source = nullptr;
+			// where read<>() goes on, metadata reads are served from `window`
+			uint64_t position = 0;
+			std::vector<uint8_t> window{};
+			uint64_t window_offset = 0;
+		};
+
+		// Image File Directory
+		struct IFD
+		{
+			Tags tag = Tags::ImageWidth;
+			DataType type = DataType::Byte;
+			uint32_t count = 0;
+			uint32_t value = 0;
+			uint32_t value2 = 0;
+
+			std::vector<uint32_t> pvalue{};
+			std::vector<uint32_t> pvalue2{};
+
+			ReaderTable table{};
+		};
+
+#if TIFF_CXX_HAS_IO_URING
+		// a bare io_uring (no liburing needed) which keeps up to `entries` reads in flight
+		class ReaderUring
+		{
+		public:
+			~ReaderUring() noexcept
+			{
+				close();
+			}
+
+			bool good() const noexcept
+			{
+				return _ring_fd >= 0;
+			}
+
+			bool open(unsigned entries) noexcept
+			{
+				close();
+
+				io_uring_params params{};
+				_ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+				if (_ring_fd < 0)
+				{
+					return false;
+				}
+
+				_sq_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+				_cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+				if (params.features & IORING_FEAT_SINGLE_MMAP)
+				{
+					_sq_size = _cq_size = std::max(_sq_size, _cq_size);
+				}
+				_sq_ptr = mmap(nullptr, _sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring_fd, IORING_OFF_SQ_RING);
+				_cq_ptr = (params.features & IORING_FEAT_SINGLE_MMAP) ? _sq_ptr
+					: mmap(nullptr, _cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring_fd, IORING_OFF_CQ_RING);
+				_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+				_sqes = (io_uring_sqe*)mmap(nullptr, _sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring_fd, IORING_OFF_SQES);
+				if (_sq_ptr == MAP_FAILED || _cq_ptr == MAP_FAILED || _sqes == MAP_FAILED)
+				{
+					close();
+					return false;
+				}
+
+				uint8_t* sq = (uint8_t*)_sq_ptr;
+				uint8_t* cq = (uint8_t*)_cq_ptr;
+				_sq_tail = (uint32_t*)(sq + params.sq_off.tail);
+				_sq_mask = *(uint32_t*)(sq + params.sq_off.ring_mask);
+				_sq_array = (uint32_t*)(sq + params.sq_off.array);
+				_cq_head = (uint32_t*)(cq + params.cq_off.head);
+				_cq_tail = (uint32_t*)(cq + params.cq_off.tail);
+				_cq_mask = *(uint32_t*)(cq + params.cq_off.ring_mask);
+				_cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+				_entries = params.sq_entries;
+				return true;
+			}
+
+			void close() noexcept
+			{
+				if (_sqes != nullptr && _sqes != MAP_FAILED)
+				{
+					munmap(_sqes, _sqes_size);
+				}
+				if (_cq_ptr != nullptr && _cq_ptr != MAP_FAILED && _cq_ptr != _sq_ptr)
+				{
+					munmap(_cq_ptr, _cq_size);
+				}
+				if (_sq_ptr != nullptr && _sq_ptr != MAP_FAILED)
+				{
+					munmap(_sq_ptr, _sq_size);
+				}
+				if (_ring_fd >= 0)
+				{
+					::close(_ring_fd);
+				}
+				_sqes = nullptr;
+				_cq_ptr = nullptr;
+				_sq_ptr = nullptr;
+				_ring_fd = -1;
+			}
+
+			// submits every run, refilling the queue as reads complete. runs the kernel did not
+			// finish (errors, short reads, an old kernel without IORING_OP_READ) keep a smaller result
+			bool read_all(int fd, std::vector<ReadRequest>& runs) noexcept
+			{
+				size_t submitted = 0;
+				size_t completed = 0;
+				unsigned pending = 0;
+				while (completed < runs.size())
+				{
+					unsigned to_submit = 0;
+					uint32_t tail = *_sq_tail;
+					while (submitted < runs.size() && submitted - completed < _entries)
+					{
+						const ReadRequest& run = runs[submitted];
+						const uint32_t index = tail & _sq_mask;
+						io_uring_sqe& sqe = _sqes[index];
+						std::memset(&sqe, 0, sizeof(sqe));
+						sqe.opcode = IORING_OP_READ;
+						sqe.fd = fd;
+						sqe.addr = reinterpret_cast<uint64_t>(run.data);
+						sqe.len = static_cast<uint32_t>(run.size);
+						sqe.off = run.offset;
+						sqe.user_data = submitted;
+						_sq_array[index] = index;
+						++tail;
+						++submitted;
+						++to_submit;
+					}
+					__atomic_store_n(_sq_tail, tail, __ATOMIC_RELEASE);
+
+					pending += to_submit;
+					const long entered = syscall(__NR_io_uring_enter, _ring_fd, pending, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+					if (entered < 0 && errno != EINTR)
+					{
+						return false;
+					}
+					pending -= entered > 0 ? static_cast<unsigned>(entered) : 0;
+
+					uint32_t head = *_cq_head;
+					const uint32_t cq_tail = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+					for (; head != cq_tail; ++head, ++completed)
+					{
+						const io_uring_cqe& cqe = _cqes[head & _cq_mask];
+						runs[cqe.user_data].result = cqe.res > 0 ? static_cast<uint64_t>(cqe.res) : 0;
+					}
+					__atomic_store_n(_cq_head, head, __ATOMIC_RELEASE);
+				}
+				return true;
+			}
+
+		private:
+			int _ring_fd = -1;
+			unsigned _entries = 0;
+
+			void* _sq_ptr = nullptr;
+			void* _cq_ptr = nullptr;
+			size_t _sq_size = 0;
+			size_t _cq_size = 0;
+			io_uring_sqe* _sqes = nullptr;
+			size_t _sqes_size = 0;
+
+			uint32_t* _sq_tail = nullptr;
+			uint32_t _sq_mask = 0;
+			uint32_t* _sq_array = nullptr;
+			uint32_t* _cq_head = nullptr;
+			uint32_t* _cq_tail = nullptr;
+			uint32_t _cq_mask = 0;
+			io_uring_cqe* _cqes = nullptr;
+		};
+#endif
+
+#ifdef POSIX_FADV_NORMAL
+		// passes a hint on to the page cache behind `fd`, size 0 reaches the end of the file
+		inline void advise_file(int fd, uint64_t offset, uint64_t size, AccessHint hint) noexcept
+		{
+			int advice = POSIX_FADV_NORMAL;
+			switch (hint)
+			{
+			case AccessHint::Sequential:
+				advice = POSIX_FADV_SEQUENTIAL;
+				break;
+			case AccessHint::Random:
+				advice = POSIX_FADV_RANDOM;
+				break;
+			case AccessHint::WillNeed:
+				advice = POSIX_FADV_WILLNEED;
+				break;
+			case AccessHint::DontNeed:
+				advice = POSIX_FADV_DONTNEED;
+				break;
+			default:
+				break;
+			}
+			if (fd >= 0)
+			{
+				posix_fadvise(fd, static_cast<off_t>(offset), static_cast<off_t>(size), advice);
+			}
+		}
+#endif
+
+		// the default source, reads through std::ifstream
+		class StreamSource : public ByteSource
+		{
+		public:
+#ifdef POSIX_FADV_NORMAL
+			~StreamSource() noexcept
+			{
+				if (_advice_fd >= 0)
+				{
+					::close(_advice_fd);
+				}
+			}
+
+			// the stream hides its descriptor, a second one (opened on the first hint) reaches the same page cache.
+			// Sequential and Random would only set the read ahead of that descriptor, which never reads, so they are dropped
+			void advise(uint64_t offset, uint64_t size, AccessHint hint) noexcept override
+			{
+				if (hint != AccessHint::WillNeed && hint != AccessHint::DontNeed)
+				{
+					return;
+				}
+				if (_advice_fd < 0)
+				{
+					_advice_fd = ::open(_path.c_str(), O_RDONLY | O_CLOEXEC);
+				}
+				advise_file(_advice_fd, offset, size, hint);
+			}
+#endif
+
+			Error open(const std::filesystem::path& path)
+			{
+				_stream.open(path, std::ios_base::binary);
+				if (!_stream.good())
+				{
+					return Error::OpenFileFailed;
+				}
+				_path = path;
+				// the file system knows the size, reading through the stream to find it would touch every byte
+				std::error_code ec{};
+				_size = std::filesystem::file_size(path, ec);
+				if (ec)
+				{
+					return Error::OpenFileFailed;
+				}
+				return Error::NoError;
+			}
+
+			uint64_t size() const noexcept override
+			{
+				return _size;
+			}
+
+			uint64_t refresh_size() noexcept override
+			{
+				_stream.clear();
+				_stream.seekg(0, std::ios_base::end);
+				const std::streamoff end = _stream.tellg();
+				if (end >= 0)
+				{
+					_size = static_cast<uint64_t>(end);
+				}
+				return _size;
+			}
+
+			uint64_t read_at(uint64_t offset, void* buffer, uint64_t count) noexcept override
+			{
+				_stream.clear();
+				_stream.seekg(static_cast<std::streamoff>(offset), std::ios_base::beg);
+				_stream.read((char*)buffer, static_cast<std::streamsize>(count));
+				return static_cast<uint64_t>(_stream.gcount());
+			}
+
+		private:
+			std::ifstream _stream{};
+			std::filesystem::path _path{};
+			uint64_t _size = 0;
+#ifdef POSIX_FADV_NORMAL
+			int _advice_fd = -1;
+#endif
+		};
+
+		// memory owned by the caller
+		class MemorySource : public ByteSource
+		{
+		public:
+			MemorySource(const void* data, size_t size) noexcept
+				: _data((const uint8_t*)data), _size(data != nullptr ? size : 0)
+			{
+			}
+
+			uint64_t size() const noexcept override
+			{
+				return _size;
+			}
+
+			uint64_t read_at(uint64_t offset, void* buffer, uint64_t count) noexcept override
+			{
+				if (offset >= _size)
+				{
+					return 0;
+				}
+				count = std::min(count, _size - offset);
+				std::memcpy(buffer, _data + offset, static_cast<size_t>(count));
+				return count;
+			}
+
+			const uint8_t* data_at(uint64_t offset, uint64_t count) const noexcept override
+			{
+				return (offset <= _size && count <= _size - offset) ? _data + offset : nullptr;
+			}
+
+		protected:
+			MemorySource() noexcept = default;
+
+			const uint8_t* _data = nullptr;
+			uint64_t _size = 0;
+		};
+
+		// the whole file mapped read only
+		class MmapSource : public MemorySource
+		{
+		public:
+			~MmapSource() noexcept
+			{
+#ifdef _WIN32
+				if (_data != nullptr)
+				{
+					UnmapViewOfFile(_data);
+				}
+#else
+				if (_data != nullptr)
+				{
+					munmap((void*)_data, static_cast<size_t>(_size));
+				}
+#endif
+			}
+
+			// a grown file is mapped again, pointers from data_at do not outlive the read that asked for them
+			uint64_t refresh_size() noexcept override
+			{
+				std::error_code ec{};
+				MmapSource grown{};
+				if (std::filesystem::file_size(_path, ec) > _size && !ec
+					&& grown.open(_path) == Error::NoError && grown._size > _size)
+				{
+					std::swap(_data, grown._data);
+					std::swap(_size, grown._size);
+				}
+				return _size;
+			}
+
+			Error open(const std::filesystem::path& path)
+			{
+				_path = path;
+#ifdef _WIN32
+				HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+				if (file == INVALID_HANDLE_VALUE)
+				{
+					return Error::OpenFileFailed;
+				}
+				LARGE_INTEGER size{};
+				GetFileSizeEx(file, &size);
+				// an empty file can not be mapped, it just has no bytes
+				HANDLE mapping = size.QuadPart > 0 ? CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+				CloseHandle(file);
+				if (mapping != nullptr)
+				{
+					_data = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+					CloseHandle(mapping);
+					if (_data == nullptr)
+					{
+						return Error::OpenFileFailed;
+					}
+					_size = static_cast<uint64_t>(size.QuadPart);
+				}
+#else
+				const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+				if (fd < 0)
+				{
+					return Error::OpenFileFailed;
+				}
+				struct stat info{};
+				fstat(fd, &info);
+				// an empty file can not be mapped, it just has no bytes
+				if (info.st_size > 0)
+				{
+					void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+					if (data == MAP_FAILED)
+					{
+						::close(fd);
+						return Error::OpenFileFailed;
+					}
+					_data = (const uint8_t*)data;
+					_size = static_cast<uint64_t>(info.st_size);
+				}
+				::close(fd);
+#endif
+				return Error::NoError;
+			}
+
+#ifndef _WIN32
+			void advise(uint64_t offset, uint64_t size, AccessHint hint) noexcept override
+			{
+				int advice = MADV_NORMAL;
+				switch (hint)
+				{
+				case AccessHint::Sequential:
+					advice = MADV_SEQUENTIAL;
+					break;
+				case AccessHint::Random:
+					advice = MADV_RANDOM;
+					break;
+				case AccessHint::WillNeed:
+					advice = MADV_WILLNEED;
+					break;
+				case AccessHint::DontNeed:
+					advice = MADV_DONTNEED;
+					break;
+				default:
+					break;
+				}
+				if (_data == nullptr || offset >= _size)
+				{
+					return;
+				}
+				// madvise takes whole pages
+				const uint64_t page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+				const uint64_t begin = offset / page * page;
+				const uint64_t end = (size == 0 || size > _size - offset) ? _size : offset + size;
+				madvise((void*)(_data + begin), static_cast<size_t>(end - begin), advice);
+			}
+#endif
+
+		private:
+			std::filesystem::path _path{};
+		};
+
+#if TIFF_CXX_HAS_IO_URING
+		// pread on a plain descriptor, batches go through io_uring
+		class UringSource : public ByteSource
+		{
+		public:
+			// reads of a band are cut into pieces of this size, so that the device sees a deep queue
+			static constexpr uint64_t piece_bytes = 512 * 1024;
+			static constexpr unsigned entries = 64;
+
+			~UringSource() noexcept
+			{
+				_uring.close();
+				if (_fd >= 0)
+				{
+					::close(_fd);
+				}
+			}
+
+			Error open(const std::filesystem::path& path)
+			{
+				_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+				if (_fd < 0)
+				{
+					return Error::OpenFileFailed;
+				}
+				struct stat info{};
+				fstat(_fd, &info);
+				_size = static_cast<uint64_t>(info.st_size);
+				// a kernel refusing rings (old, or blocked by seccomp) leaves plain pread
+				_uring.open(entries);
+				return Error::NoError;
+			}
+
+			uint64_t size() const noexcept override
+			{
+				return _size;
+			}
+
+			uint64_t refresh_size() noexcept override
+			{
+				struct stat info{};
+				if (fstat(_fd, &info) == 0)
+				{
+					_size = static_cast<uint64_t>(info.st_size);
+				}
+				return _size;
+			}
+
+			void advise(uint64_t offset, uint64_t size, AccessHint hint) noexcept override
+			{
+				advise_file(_fd, offset, size, hint);
+			}
+
+			uint64_t read_at(uint64_t offset, void* buffer, uint64_t count) noexcept override
+			{
+				uint64_t done = 0;
+				while (done < count)
+				{
+					const ssize_t got = pread(_fd, (uint8_t*)buffer + done, count - done, static_cast<off_t>(offset + done));
+					if (got <= 0 && !(got < 0 && errno == EINTR))
+					{
+						break;
+					}
+					done += got > 0 ? static_cast<uint64_t>(got) : 0;
+				}
+				return done;
+			}
+
+			void read_batch(std::vector<ReadRequest>& requests) noexcept override
+			{
+				std::vector<ReadRequest> pieces{};
+				for (const auto& request : requests)
+				{
+					for (uint64_t done = 0; done < request.size; done += piece_bytes)
+					{
+						ReadRequest piece{};
+						piece.offset = request.offset + done;
+						piece.size = std::min(piece_bytes, request.size - done);
+						piece.data = request.data + done;
+						pieces.emplace_back(piece);
+					}
+				}
+				if (_uring.good() && !_uring.read_all(_fd, pieces))
+				{
+					_uring.close();
+				}
+				for (auto& piece : pieces)
+				{
+					// pread finishes whatever the ring did not
+					if (piece.result < piece.size)
+					{
+						piece.result += read_at(piece.offset + piece.result, piece.data + piece.result, piece.size - piece.result);
+					}
+				}
+
+				size_t p = 0;
+				for (auto& request : requests)
+				{
+					request.result = 0;
+					bool complete = true;
+					for (uint64_t done = 0; done < request.size; done += piece_bytes, ++p)
+					{
+						if (complete)
+						{
+							request.result += pieces[p].result;
+							complete = pieces[p].result == pieces[p].size;
+						}
+					}
+				}
+			}
+
+		private:
+			int _fd = -1;
+			uint64_t _size = 0;
+			ReaderUring _uring{};
+		};
+#endif
+
+#if TIFF_CXX_HAS_DIRECT_IO
+		// reads around the page cache: every request is widened to whole device blocks,
+		// read into aligned buffers from a pool and the wanted bytes are sliced out
+		class DirectSource : public ByteSource
+		{
+		public:
+			// O_DIRECT wants offsets, sizes and buffers aligned to the logical block size, 4 KiB covers common devices
+			static constexpr uint64_t alignment = 4096;
+			static constexpr uint64_t piece_bytes = 256 * 1024;
+			static constexpr unsigned entries = 64;
+
+			~DirectSource() noexcept
+			{
+#if TIFF_CXX_HAS_IO_URING
+				_uring.close();
+#endif
+				for (uint8_t* buffer : _pool)
+				{
+					::operator delete(buffer, std::align_val_t(alignment));
+				}
+				if (_fd >= 0)
+				{
+					::close(_fd);
+				}
+			}
+
+			Error open(const std::filesystem::path& path)
+			{
+				_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_DIRECT);
+				if (_fd < 0 && errno == EINVAL)
+				{
+					// file systems without direct I/O (tmpfs for one) still get the aligned reads, through the cache
+					_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+				}
+				if (_fd < 0)
+				{
+					return Error::OpenFileFailed;
+				}
+				struct stat info{};
+				fstat(_fd, &info);
+				_size = static_cast<uint64_t>(info.st_size);
+#if TIFF_CXX_HAS_IO_URING
+				_uring.open(entries);
+#endif
+				return Error::NoError;
+			}
+
+			uint64_t size() const noexcept override
+			{
+				return _size;
+			}
+
+			uint64_t refresh_size() noexcept override
+			{
+				struct stat info{};
+				if (fstat(_fd, &info) == 0)
+				{
+					_size = static_cast<uint64_t>(info.st_size);
+				}
+				return _size;
+			}
+
+			uint64_t read_at(uint64_t offset, void* buffer, uint64_t count) noexcept override
+			{
+				std::vector<ReadRequest> requests(1);
+				requests[0].offset = offset;
+				requests[0].size = count;
+				requests[0].data = (uint8_t*)buffer;
+				read_batch(requests);
+				return requests[0].result;
+			}
+
+			void read_batch(std::vector<ReadRequest>& requests) noexcept override
+			{
+				std::vector<ReadRequest> pieces{};
+				std::vector<size_t> first_piece{};
+				for (const auto& request : requests)
+				{
+					first_piece.emplace_back(pieces.size());
+					const uint64_t begin = request.offset / alignment * alignment;
+					const uint64_t end = (request.offset + request.size + alignment - 1) / alignment * alignment;
+					for (uint64_t offset = begin; offset < end; offset += piece_bytes)
+					{
+						ReadRequest piece{};
+						piece.offset = offset;
+						piece.size = std::min(piece_bytes, end - offset);
+						piece.data = acquire();
+						pieces.emplace_back(piece);
+					}
+				}
+				first_piece.emplace_back(pieces.size());
+
+#if TIFF_CXX_HAS_IO_URING
+				if (_uring.good() && !_uring.read_all(_fd, pieces))
+				{
+					_uring.close();
+				}
+#endif
+				for (auto& piece : pieces)
+				{
+					// pread finishes whatever the ring did not, short reads only happen at the end of the file
+					while (piece.data != nullptr && piece.result < piece.size)
+					{
+						const ssize_t got = pread(_fd, piece.data + piece.result, piece.size - piece.result,
+							static_cast<off_t>(piece.offset + piece.result));
+						if (got <= 0 && !(got < 0 && errno == EINTR))
+						{
+							break;
+						}
+						piece.result += got > 0 ? static_cast<uint64_t>(got) : 0;
+					}
+				}
+
+				for (size_t r = 0; r < requests.size(); ++r)
+				{
+					auto& request = requests[r];
+					const uint64_t request_end = request.offset + request.size;
+					uint64_t offset = request.offset;
+					request.result = 0;
+					for (size_t p = first_piece[r]; p < first_piece[r + 1] && offset < request_end; ++p)
+					{
+						const auto& piece = pieces[p];
+						const uint64_t wanted_end = std::min(request_end, piece.offset + piece.size);
+						const uint64_t got_end = std::min(wanted_end, piece.offset + piece.result);
+						if (got_end > offset)
+						{
+							std::memcpy(request.data + (offset - request.offset), piece.data + (offset - piece.offset),
+								static_cast<size_t>(got_end - offset));
+							request.result += got_end - offset;
+						}
+						if (got_end < wanted_end)
+						{
+							break;
+						}
+						offset = wanted_end;
+					}
+				}
+
+				for (auto& piece : pieces)
+				{
+					release(piece.data);
+				}
+			}
+
+		private:
+			// the pool keeps up to a queue depth of buffers, larger batches allocate the rest and free them afterwards
+			uint8_t* acquire() noexcept
+			{
+				if (_pool.empty())
+				{
+					return (uint8_t*)::operator new(piece_bytes, std::align_val_t(alignment), std::nothrow);
+				}
+				uint8_t* buffer = _pool.back();
+				_pool.pop_back();
+				return buffer;
+			}
+
+			void release(uint8_t* buffer) noexcept
+			{
+				if (buffer == nullptr)
+				{
+					return;
+				}
+				if (_pool.size() < entries)
+				{
+					_pool.emplace_back(buffer);
+					return;
+				}
+				::operator delete(buffer, std::align_val_t(alignment));
+			}
+
+			int _fd = -1;
+			uint64_t _size = 0;
+			std::vector<uint8_t*> _pool{};
+#if TIFF_CXX_HAS_IO_URING
+			ReaderUring _uring{};
+#endif
+		};
+#endif
+
+		struct ReaderPrivate
+		{
+			std::filesystem::path tiff_path{};
+			ReaderFile file{};
+			std::string last_error{};
+			bool good = false;
+
+			// largest single read, also bounds the strip or tile bytes held in memory while decoding
+			size_t max_read_size = 4 * 1024 * 1024;
+
+			std::filesystem::path index_path{};
+
+			IoBackend io_backend = IoBackend::Stream;
+			HalfFloat half_float = HalfFloat::Raw;
+			std::optional<Conversion> conversion{};
+			bool expand_palette = false;
+			bool convert_color = false;
+			bool apply_orientation = false;
+			uint32_t decode_threads = 1;
+			AccessHint access_pattern = AccessHint::Normal;
+			bool follow = false;
+
+			// metadata is parsed through a window of this size instead of one read per value
+			static constexpr size_t window_bytes = 16 * 1024;
+
+			// readers made over memory or a custom source keep it, a path is opened with the chosen backend
+			Error open_source()
+			{
+				Error err = Error::NoError;
+				if (!tiff_path.empty())
+				{
+					err = open_path(file.source);
+				}
+				if (err != Error::NoError || file.source == nullptr)
+				{
+					return err != Error::NoError ? err : Error::OpenFileFailed;
+				}
+
+				file.size = file.source->size();
+				file.window.clear();
+				file.window_offset = 0;
+				return Error::NoError;
+			}
+
+			// `source` is only replaced once the file opened with the chosen backend
+			Error open_path(std::shared_ptr<ByteSource>& source)
+			{
+				Error err = Error::NoError;
+				switch (io_backend)
+				{
+#if TIFF_CXX_HAS_IO_URING
+				case IoBackend::IoUring:
+				{
+					auto uring_source = std::make_shared<UringSource>();
+					err = uring_source->open(tiff_path);
+					if (err == Error::NoError) source = uring_source;
+					break;
+				}
+#endif
+#if TIFF_CXX_HAS_DIRECT_IO
+				case IoBackend::Direct:
+				{
+					auto direct_source = std::make_shared<DirectSource>();
+					err = direct_source->open(tiff_path);
+					if (err == Error::NoError) source = direct_source;
+					break;
+				}
+#endif
+				case IoBackend::Mmap:
+				{
+					auto mmap_source = std::make_shared<MmapSource>();
+					err = mmap_source->open(tiff_path);
+					if (err == Error::NoError) source = mmap_source;
+					break;
+				}
+				default:
+				{
+					auto stream_source = std::make_shared<StreamSource>();
+					err = stream_source->open(tiff_path);
+					if (err == Error::NoError) source = stream_source;
+					break;
+				}
+				}
+				return err;
+			}
+
+			// tells the source how the whole file is used from now on, only when that changes
+			void advise_pattern(AccessHint pattern)
+			{
+				if (access_pattern != pattern && file.source != nullptr)
+				{
+					access_pattern = pattern;
+					file.source->advise(0, 0, pattern);
+				}
+			}
+
+			// covers the bytes from the first to the last strip or tile of `frame`
+			void advise_frame(const ReaderFrame& frame, AccessHint hint)
+			{
+				const auto& offsets = frame.is_tiled ? frame.tile_offsets : frame.strip_offsets;
+				const auto& byte_counts = frame.is_tiled ? frame.tile_byte_counts : frame.strip_byte_counts;
+				uint64_t begin = std::numeric_limits<uint64_t>::max();
+				uint64_t end = 0;
+				for (size_t i = 0; i < offsets.size() && i < byte_counts.size(); ++i)
+				{
+					begin = std::min<uint64_t>(begin, offsets[i]);
+					end = std::max<uint64_t>(end, static_cast<uint64_t>(offsets[i]) + byte_counts[i]);
+				}
+				if (!frame.tables_loaded && frame.offsets_table.count > 0
+					&& frame.offsets_table.count == frame.byte_counts_table.count)
+				{
+					// without the tables, the first and last block bound the range as they are written in order
+					const uint32_t last = frame.offsets_table.count - 1;
+					begin = read_table_value(frame.offsets_table, 0);
+					end = static_cast<uint64_t>(read_table_value(frame.offsets_table, last)) + read_table_value(frame.byte_counts_table, last);
+				}
+				if (begin < end && file.source != nullptr)
+				{
+					file.source->advise(begin, end - begin, hint);
+				}
+			}
+
+			void seek(uint64_t offset) noexcept
+			{
+				file.position = offset;
+			}
+
+			// copies `count` bytes at the current position and moves past them, false if the source ends first
+			bool read_bytes(void* buffer, size_t count)
+			{
+				const uint64_t offset = file.position;
+				file.position += count;
+				if (offset > file.size || count > file.size - offset)
+				{
+					return false;
+				}
+				if (const uint8_t* data = file.source->data_at(offset, count))
+				{
+					std::memcpy(buffer, data, count);
+					return true;
+				}
+				if (offset < file.window_offset || offset + count > file.window_offset + file.window.size())
+				{
+					file.window.resize(std::max(window_bytes, count));
+					file.window.resize(static_cast<size_t>(file.source->read_at(offset, file.window.data(), file.window.size())));
+					file.window_offset = offset;
+					if (count > file.window.size())
+					{
+						return false;
+					}
+				}
+				std::memcpy(buffer, file.window.data() + (offset - file.window_offset), count);
+				return true;
+			}
+
+			template<typename value_t>
+			value_t byte_swap_if_need(value_t n) const noexcept
+			{
+				if (file.system_byte_order != file.file_byte_order)
+				{
+					return util::byte_swap(n);
+				}
+				return n;
+			}
+
+			template<typename value_t>
+			value_t read()
+			{
+				value_t result{};
+				if (read_bytes(&result, sizeof(result)))
+				{
+					result = byte_swap_if_need(result);
+				}
+				return result;
+			}
+
+			// strip and tile tables, and the color map, which is only needed once a palette image is expanded
+			static bool is_lazy_table(Tags tag) noexcept
+			{
+				return tag == Tags::StripOffsets || tag == Tags::StripByteCounts
+					|| tag == Tags::TileOffsets || tag == Tags::TileByteCounts || tag == Tags::ColorMap;
+			}
+
+			IFD read_ifd(bool load_tables = true)
+			{
+				IFD d{};
+
+				d.tag = Tags(read<uint16_t>());
+				d.type = DataType(read<uint16_t>());
+				d.count = read<uint32_t>();
+
+				const uint64_t pos = file.position;
+				bool pos_changed = false;
+
+				if (is_lazy_table(d.tag))
+				{
+					const uint64_t value_size = (d.type == DataType::Short) ? 2 : 4;
+					d.table.type = d.type;
+					d.table.count = d.count;
+					d.table.data_offset = (value_size * d.count <= 4) ? pos : read<uint32_t>();
+
+					// the tables can be huge, without load_tables only their location is kept
+					seek(pos);
+					if (!load_tables)
+					{
+						seek(pos + 4);
+						return d;
+					}
+				}
+
+				switch (d.type)
+				{
+				case DataType::Byte:
+				case DataType::ASCII:
+				{
+					if (d.count > 0)
+					{
+						if (d.count <= 4)
+						{
+							for (int i = 0; i < 4; ++i)
+							{
+								uint32_t v = read<uint8_t>();
+								if (i < d.count) d.pvalue.emplace_back(v);
+							}
+						}
+						else
+						{
+							pos_changed = true;
+							uint32_t offset = read<uint32_t>();
+							if (offset + static_cast<uint64_t>(d.count) * 1 <= file.size)
+							{
+								seek(offset);
+								for (uint32_t i = 0; i < d.count; ++i)
+								{
+									d.pvalue.emplace_back(read<uint8_t>());
+								}
+							}
+						}
+					}
+					break;
+				}
+				case DataType::Short:
+				{
+					if (d.count <= 2)
+					{
+						for (int i = 0; i < 2; ++i)
+						{
+							uint32_t v = read<uint16_t>();
+							if (i < d.count) d.pvalue.emplace_back(v);
+						}
+					}
+					else
+					{
+						pos_changed = true;
+						uint32_t offset = read<uint32_t>();
+						if (offset + static_cast<uint64_t>(d.count) * 2 <= file.size)
+						{
+							seek(offset);
+							for (uint32_t i = 0; i < d.count; ++i)
+							{
+								d.pvalue.emplace_back(read<uint16_t>());
+							}
+						}
+					}
+					break;
+				}
+				case DataType::Long:
+				case DataType::IFD:
+				{
+					if (d.count <= 1)
+					{
+						d.pvalue.emplace_back(read<uint32_t>());
+					}
+					else
+					{
+						pos_changed = true;
+						uint32_t offset = read<uint32_t>();
+						if (offset + static_cast<uint64_t>(d.count) * 4 <= file.size)
+						{
+							seek(offset);
+							for (uint32_t i = 0; i < d.count; ++i)
+							{
+								d.pvalue.emplace_back(read<uint32_t>());
+							}
+						}
+					}
+					break;
+				}
+				case DataType::Rational:
+				{
+					pos_changed = true;
+					uint32_t offset = read<uint32_t>();
+					if (offset + static_cast<uint64_t>(d.count) * 8 <= file.size)
+					{
+						seek(offset);
+						for (uint32_t i = 0; i < d.count; ++i)
+						{
+							d.pvalue.emplace_back(read<uint32_t>());
+							d.pvalue2.emplace_back(read<uint32_t>());
+						}
+					}
+
+					break;
+				}
+				default:
+				{
+					d.value = read<uint32_t>();
+					break;
+				}
+				}
+
+				if (!d.pvalue.empty()) d.value = d.pvalue[0];
+				if (!d.pvalue2.empty()) d.value2 = d.pvalue2[0];
+
+				if (pos_changed)
+				{
+					seek(pos + 4);
+				}
+
+				return d;
+			}
+
+			// parses the IFD at `ifd_offset` into `frame`, `next_offset` gets the offset of the following IFD.
+			// without load_tables the strip and tile tables stay in the file, see read_table_value
+			Error parse_frame(uint32_t ifd_offset, ReaderFrame& frame, uint32_t& next_offset, bool load_tables = true)
+			{
+				Error err = Error::NoError;
+				frame = ReaderFrame{};
+				next_offset = 0;
+
+				if (ifd_offset != 0 && static_cast<uint64_t>(ifd_offset) + 2 < file.size)
+				{
+					seek(ifd_offset);
+					uint16_t ifd_count = read<uint16_t>();
+					for (uint16_t i = 0; i < ifd_count; ++i)
+					{
+						IFD ifd = read_ifd(load_tables);
+						switch (ifd.tag)
+						{
+						case Tags::ImageWidth:
+						{
+							frame.width = ifd.value;
+							break;
+						}
+						case Tags::ImageLength:
+						{
+							frame.image_length = ifd.value;
+							break;
+						}
+						case Tags::BitsPerSample:
+						{
+							frame.bits_per_sample = ifd.value;
+							if (ifd.count > 0 && !ifd.pvalue.empty())
+							{
+								frame.bits_per_sample = ifd.pvalue[0];
+								bool ok = true;
+								for (size_t j = 1; j < ifd.pvalue.size(); ++j)
+								{
+									if (ifd.pvalue.at(j) != ifd.pvalue[0])
+									{
+										ok = false; break;
+									}
+								}
+								if (!ok)
+								{
+									err = Error::MultiSampleSizeNotSupport;
+								}
+							}
+							break;
+						}
+						case Tags::Compression:
+						{
+							frame.compression = CompressionType(ifd.value);
+							break;
+						}
+						case Tags::StripOffsets:
+						{
+							frame.offsets_table = ifd.table;
+							frame.strip_count = ifd.count;
+							if (ifd.count > 0 && !ifd.pvalue.empty())
+							{
+								frame.strip_count = ifd.count;
+								for (const auto& v : ifd.pvalue)
+								{
+									frame.strip_offsets.emplace_back(v);
+								}
+							}
+							break;
+						}
+						case Tags::SamplesPerPixel:
+						{
+							frame.samples_per_pixel = ifd.value;
+							break;
+						}
+						case Tags::RowsPerStrip:
+						{
+							frame.rows_per_strip = ifd.value;
+							break;
+						}
+						case Tags::SampleFormat:
+						{
+							frame.sample_format = SampleFormat(ifd.value);
+							break;
+						}
+						case Tags::ImageDescription:
+						{
+							if (ifd.count > 0 && !ifd.pvalue.empty())
+							{
+								frame.description = "";
+								for (size_t j = 0; j < ifd.pvalue.size() && ifd.pvalue[j] != 0; ++j)
+								{
+									frame.description += (char)ifd.pvalue[j];
+								}
+							}
+							break;
+						}
+						case Tags::StripByteCounts:
+						{
+							frame.byte_counts_table = ifd.table;
+							frame.strip_count = ifd.count;
+							if (ifd.count > 0 && !ifd.pvalue.empty())
+							{
+								frame.strip_count = ifd.count;
+								for (const auto& v : ifd.pvalue)
+								{
+									frame.strip_byte_counts.emplace_back(v);
+								}
+							}
+							break;
+						}
+						case Tags::PlanarConfig:
+						{
+							frame.planar_config = PlanarConfiguration(ifd.value);
+							break;
+						}
+						case Tags::Orientation:
+						{
+							frame.orientation = Orientation(ifd.value);
+							break;
+						}
+						case Tags::PhotometricInterpretation:
+						{
+							frame.photometric_interpertation = PhotometricInterpretation(ifd.value);
+							break;
+						}
+						case Tags::FillOrder:
+						{
+							frame.fill_order = FillOrder(ifd.value);
+							break;
+						}
+						case Tags::TileWidth:
+						{
+							frame.is_tiled = true;
+							frame.tile_width = ifd.value;
+							break;
+						}
+						case Tags::TileLength:
+						{
+							frame.is_tiled = true;
+							frame.tile_length = ifd.value;
+							break;
+						}
+						case Tags::TileOffsets:
+						{
+							frame.is_tiled = true;
+							frame.offsets_table = ifd.table;
+							frame.tile_offsets = ifd.pvalue;
+							break;
+						}
+						case Tags::TileByteCounts:
+						{
+							frame.is_tiled = true;
+							frame.byte_counts_table = ifd.table;
+							frame.tile_byte_counts = ifd.pvalue;
+							break;
+						}
+						case Tags::NewSubfileType:
+						{
+							frame.subfile_type = SubfileType(ifd.value);
+							break;
+						}
+						case Tags::ColorMap:
+						{
+							frame.color_map_table = ifd.table;
+							frame.color_map.assign(ifd.pvalue.begin(), ifd.pvalue.end());
+							break;
+						}
+						case Tags::YCbCrSubSampling:
+						{
+							if (ifd.pvalue.size() == 2)
+							{
+								frame.ycbcr_subsampling_h = ifd.pvalue[0];
+								frame.ycbcr_subsampling_v = ifd.pvalue[1];
+							}
+							break;
+						}
+						case Tags::SubIFDs:
+						{
+							frame.sub_ifds = ifd.pvalue;
+							break;
+						}
+						case Tags::XResolution:
+						{
+							frame.resolution.x = (float(ifd.value) / float(ifd.value2));
+							break;
+						}
+						case Tags::YResolution:
+						{
+							frame.resolution.y = (float(ifd.value) / float(ifd.value2));
+							break;
+						}
+						case Tags::ResolutionUnit:
+						{
+							frame.resolution_unit = ResolutionUnit(ifd.value);
+							break;
+						}
+						default:
+							break;
+						}
+					}
+					frame.height = frame.image_length;
+					frame.tables_loaded = load_tables;
+					file.last_next_field = static_cast<uint64_t>(ifd_offset) + 2 + 12 * static_cast<uint64_t>(ifd_count);
+					seek(file.last_next_field);
+					next_offset = read<uint32_t>();
+
+				}
+				else
+				{
+					err = Error::NoMoreImagesInTiff;
+				}
+
+				return err;
+			}
+
+			static bool is_reduced_resolution(SubfileType type) noexcept
+			{
+				return (uint32_t(type) & uint32_t(SubfileType::ReducedResolution)) != 0;
+			}
+
+			bool is_valid_ifd_offset(uint32_t ifd_offset) const noexcept
+			{
+				return ifd_offset != 0 && static_cast<uint64_t>(ifd_offset) + 2 < file.size;
+			}
+
+			// reads just enough of the IFD at `ifd_offset` to learn its subfile type, returns the next IFD offset
+			uint32_t skip_ifd(uint32_t ifd_offset, SubfileType& subfile_type)
+			{
+				subfile_type = SubfileType::Default;
+
+				seek(ifd_offset);
+				uint16_t ifd_count = read<uint16_t>();
+				if (ifd_count > 0)
+				{
+					// NewSubfileType has the smallest baseline tag number, so it is the first entry when present
+					Tags tag = Tags(read<uint16_t>());
+					DataType type = DataType(read<uint16_t>());
+					read<uint32_t>();
+					if (tag == Tags::NewSubfileType)
+					{
+						subfile_type = SubfileType(type == DataType::Short ? read<uint16_t>() : read<uint32_t>());
+					}
+				}
+
+				file.last_next_field = static_cast<uint64_t>(ifd_offset) + 2 + 12 * static_cast<uint64_t>(ifd_count);
+				seek(file.last_next_field);
+				return read<uint32_t>();
+			}
+
+			// picks up what a writer appended since the ends of the chain were seen: the file size, and the
+			// next IFD offsets which were still zero. true if read_next_frame has a frame to read now
+			bool refresh()
+			{
+				file.size = file.source->refresh_size();
+				file.window.clear();
+				if (file.next_ifd_offset == 0 && file.next_ifd_field != 0)
+				{
+					seek(file.next_ifd_field);
+					file.next_ifd_offset = read<uint32_t>();
+				}
+				if (file.frame_ifds_next == 0 && file.frame_ifds_next_field != 0)
+				{
+					seek(file.frame_ifds_next_field);
+					file.frame_ifds_next = read<uint32_t>();
+				}
+				return good && is_valid_ifd_offset(file.next_ifd_offset);
+			}
+
+			// walks the IFD chain until frame `index` is known
+			// IFDs guessed ahead at once, and the longest repeating group of IFDs (a frame and its chained levels) looked for
+			static constexpr uint32_t speculative_ifds = 64;
+			static constexpr size_t speculative_period = 8;
+			static constexpr size_t speculative_history = 2 * speculative_period + 2;
+			// room for an IFD with a few more entries than the last one
+			static constexpr uint64_t speculative_slack_bytes = 96;
+
+			// what skip_ifd learns, from IFD bytes already in memory. false if `size` does not cover the IFD
+			bool parse_ifd_head(const uint8_t* data, uint64_t size, SubfileType& subfile_type, uint16_t& ifd_count, uint32_t& next_offset) const
+			{
+				subfile_type = SubfileType::Default;
+				if (size < 2)
+				{
+					return false;
+				}
+				std::memcpy(&ifd_count, data, 2);
+				ifd_count = byte_swap_if_need(ifd_count);
+				const uint64_t field = 2 + 12 * static_cast<uint64_t>(ifd_count);
+				if (size < field + 4)
+				{
+					return false;
+				}
+				if (ifd_count > 0)
+				{
+					uint16_t tag = 0;
+					uint16_t type = 0;
+					std::memcpy(&tag, data + 2, 2);
+					std::memcpy(&type, data + 4, 2);
+					if (Tags(byte_swap_if_need(tag)) == Tags::NewSubfileType)
+					{
+						uint16_t short_value = 0;
+						uint32_t long_value = 0;
+						std::memcpy(&short_value, data + 10, 2);
+						std::memcpy(&long_value, data + 10, 4);
+						subfile_type = SubfileType(DataType(byte_swap_if_need(type)) == DataType::Short
+							? byte_swap_if_need(short_value) : byte_swap_if_need(long_value));
+					}
+				}
+				std::memcpy(&next_offset, data + field, 4);
+				next_offset = byte_swap_if_need(next_offset);
+				return true;
+			}
+
+			// the chain walked so far ends with `offsets` and goes on at file.frame_ifds_next. when the offsets repeat
+			// with some period (one IFD per frame, or a frame followed by its chained levels), each shifted by the same
+			// distance per period, the next ones are guessed and fetched as one batch. they are taken while every IFD
+			// points at the guess after it, returns how many went into the index (0 leaves the walk to skip_ifd)
+			uint32_t index_speculatively(std::vector<uint64_t>& offsets, uint64_t ifd_bytes, uint32_t guesses)
+			{
+				offsets.emplace_back(file.frame_ifds_next);
+				const size_t n = offsets.size() - 1;
+				size_t period = 0;
+				for (size_t p = 1; p <= speculative_period && 2 * p + 1 <= n && period == 0; ++p)
+				{
+					bool repeats = offsets[n] > offsets[n - p];
+					for (size_t j = 1; j <= p && repeats; ++j)
+					{
+						repeats = offsets[n - j] - offsets[n - j - p] == offsets[n] - offsets[n - p];
+					}
+					period = repeats ? p : 0;
+				}
+				offsets.pop_back();
+				if (period == 0)
+				{
+					return 0;
+				}
+
+				// the first guess is where the chain really goes on
+				const uint64_t shift = file.frame_ifds_next - offsets[n - period];
+				const uint64_t request_bytes = ifd_bytes + speculative_slack_bytes;
+				std::vector<ReadRequest> requests{};
+				for (uint32_t k = 0; k < guesses; ++k)
+				{
+					const uint64_t guess = (k == 0) ? file.frame_ifds_next
+						: ((k < period) ? offsets[n - period + k] : requests[k - period].offset) + shift;
+					if (guess + 2 >= file.size || guess > std::numeric_limits<uint32_t>::max())
+					{
+						break;
+					}
+					ReadRequest request{};
+					request.offset = guess;
+					request.size = std::min(request_bytes, file.size - guess);
+					requests.emplace_back(request);
+				}
+				std::vector<uint8_t> buffer(requests.size() * static_cast<size_t>(request_bytes));
+				for (size_t k = 0; k < requests.size(); ++k)
+				{
+					requests[k].data = buffer.data() + k * request_bytes;
+				}
+				file.source->read_batch(requests);
+
+				uint32_t taken = 0;
+				for (size_t k = 0; k < requests.size(); ++k)
+				{
+					SubfileType type = SubfileType::Default;
+					uint16_t ifd_count = 0;
+					uint32_t next_offset = 0;
+					if (!parse_ifd_head(requests[k].data, requests[k].result, type, ifd_count, next_offset))
+					{
+						break;
+					}
+					if (!is_reduced_resolution(type))
+					{
+						file.frame_ifds.emplace_back(static_cast<uint32_t>(requests[k].offset));
+					}
+					offsets.emplace_back(requests[k].offset);
+					file.frame_ifds_next = next_offset;
+					file.frame_ifds_next_field = requests[k].offset + 2 + 12 * static_cast<uint64_t>(ifd_count);
+					++taken;
+					if (k + 1 >= requests.size() || next_offset != requests[k + 1].offset)
+					{
+						break;
+					}
+				}
+				return taken;
+			}
+
+			// walks the IFD chain until frame `index` is known. every IFD costs a dependent read,
+			// so once the chain shows a regular layout the IFDs ahead are guessed and fetched together
+			bool index_frames_until(uint32_t index)
+			{
+				std::vector<uint64_t> offsets{};
+				uint64_t ifd_bytes = 0;
+				while (file.frame_ifds.size() <= index && is_valid_ifd_offset(file.frame_ifds_next))
+				{
+					if (offsets.size() > speculative_history)
+					{
+						offsets.erase(offsets.begin(), offsets.end() - speculative_history);
+					}
+					const uint64_t wanted = static_cast<uint64_t>(index) + 1 - file.frame_ifds.size();
+					if (wanted > 1 && index_speculatively(offsets, ifd_bytes, static_cast<uint32_t>(std::min<uint64_t>(speculative_ifds, wanted))) > 0)
+					{
+						continue;
+					}
+
+					const uint32_t offset = file.frame_ifds_next;
+					SubfileType type = SubfileType::Default;
+					file.frame_ifds_next = skip_ifd(offset, type);
+					file.frame_ifds_next_field = file.last_next_field;
+					if (!is_reduced_resolution(type))
+					{
+						file.frame_ifds.emplace_back(offset);
+					}
+					offsets.emplace_back(offset);
+					ifd_bytes = std::max(ifd_bytes, file.last_next_field + 4 - offset);
+				}
+				return file.frame_ifds.size() > index;
+			}
+
+			Error read_next_frame()
+			{
+				// moving on from a frame means a scan, its pages can go
+				const bool scanning = good;
+				if (scanning)
+				{
+					advise_pattern(AccessHint::Sequential);
+					advise_frame(file.current_frame, AccessHint::DontNeed);
+				}
+
+				file.current_levels.clear();
+				// the strip or tile tables wait until a frame is decoded, so opening and stepping
+				// through frames costs the IFDs only, however many strips there are
+				Error err = parse_frame(file.next_ifd_offset, file.current_frame, file.next_ifd_offset, false);
+
+				// reduced resolution images chained behind the frame are its levels, not frames on their own
+				while (err == Error::NoError && is_valid_ifd_offset(file.next_ifd_offset))
+				{
+					SubfileType type = SubfileType::Default;
+					skip_ifd(file.next_ifd_offset, type);
+					if (!is_reduced_resolution(type))
+					{
+						break;
+					}
+
+					ReaderFrame level{};
+					uint32_t next_offset = 0;
+					if (parse_frame(file.next_ifd_offset, level, next_offset, false) != Error::NoError)
+					{
+						break;
+					}
+					file.current_levels.emplace_back(std::move(level));
+					file.next_ifd_offset = next_offset;
+				}
+				file.next_ifd_field = file.last_next_field;
+
+				if (err == Error::NoError)
+				{
+					for (const auto& offset : file.current_frame.sub_ifds)
+					{
+						ReaderFrame level{};
+						uint32_t next_offset = 0;
+						if (is_valid_ifd_offset(offset)
+							&& parse_frame(offset, level, next_offset, false) == Error::NoError
+							&& is_reduced_resolution(level.subfile_type))
+						{
+							file.current_levels.emplace_back(std::move(level));
+						}
+					}
+					std::stable_sort(file.current_levels.begin(), file.current_levels.end(), [](const ReaderFrame& a, const ReaderFrame& b)
+					{
+						return static_cast<uint64_t>(a.width) * a.height > static_cast<uint64_t>(b.width) * b.height;
+					});
+				}
+
+				good = (err == Error::NoError);
+				if (good && scanning)
+				{
+					advise_frame(file.current_frame, AccessHint::WillNeed);
+				}
+				return err;
+			}
+
+			Error check_frame(const ReaderFrame& frame) const
+			{
+				if (frame.compression != CompressionType::None)
+				{
+					return Error::CompressionNotSupport;
+				}
+				if (frame.is_tiled && (frame.tile_width == 0 || frame.tile_length == 0))
+				{
+					return Error::TiledNotSupport;
+				}
+				if (frame.orientation < Orientation::TopLeft || frame.orientation > Orientation::LeftBottom)
+				{
+					return Error::OrientationNotSupport;
+				}
+				if (expands_palette(frame) && (frame.bits_per_sample > 16 || frame.sample_format == SampleFormat::Float
+					|| frame.color_map.size() != (size_t(3) << frame.bits_per_sample)))
+				{
+					return Error::InvalidColorMap;
+				}
+				{
+					const ColorStage color = color_stage(frame);
+					if (color != ColorStage::None && (frame.sample_format != SampleFormat::Uint || frame.bits_per_sample > 16))
+					{
+						return Error::PhotometricInterpretationNotSupport;
+					}
+					// the samples of a pixel are converted together, so they have to lie together
+					if ((color == ColorStage::YCbCr && frame.samples_per_pixel < 3) || (color == ColorStage::CMYK && frame.samples_per_pixel < 4)
+						|| ((color == ColorStage::YCbCr || color == ColorStage::CMYK) && frame.planar_config == PlanarConfiguration::Planar))
+					{
+						return Error::PhotometricInterpretationNotSupport;
+					}
+					if (color == ColorStage::YCbCr && (frame.ycbcr_subsampling_h != 1 || frame.ycbcr_subsampling_v != 1))
+					{
+						const uint32_t h = frame.ycbcr_subsampling_h;
+						const uint32_t v = frame.ycbcr_subsampling_v;
+						const bool units_fit = frame.is_tiled
+							? (frame.tile_width % h == 0 && frame.tile_length % v == 0)
+							: (frame.rows_per_strip == 0 || frame.rows_per_strip >= frame.height || frame.rows_per_strip % v == 0);
+						if ((h != 1 && h != 2 && h != 4) || (v != 1 && v != 2 && v != 4) || v > h
+							|| frame.bits_per_sample != 8 || frame.samples_per_pixel != 3 || !units_fit)
+						{
+							return Error::PhotometricInterpretationNotSupport;
+						}
+					}
+				}
+				if (frame.width == 0 || frame.height == 0)
+				{
+					return Error::InvalidImageSize;
+				}
+				{
+					const uint32_t bits = util::decoded_bits(frame.bits_per_sample);
+					if (bits == 0 || (frame.sample_format == SampleFormat::Float && bits != frame.bits_per_sample))
+					{
+						return Error::InvalidBitPerSample;
+					}
+				}
+				return Error::NoError;
+			}
+
+			bool expands_palette(const ReaderFrame& frame) const
+			{
+				return expand_palette && frame.photometric_interpertation == PhotometricInterpretation::Palette
+					&& frame.samples_per_pixel == 1;
+			}
+
+			ColorStage color_stage(const ReaderFrame& frame) const
+			{
+				if (!convert_color)
+				{
+					return ColorStage::None;
+				}
+				switch (frame.photometric_interpertation)
+				{
+				case PhotometricInterpretation::WhiteIsZero: return ColorStage::Invert;
+				case PhotometricInterpretation::YCBCR: return ColorStage::YCbCr;
+				case PhotometricInterpretation::CMYK: return ColorStage::CMYK;
+				default: return ColorStage::None;
+				}
+			}
+
+			ReaderOrientation frame_orientation(const ReaderFrame& frame) const
+			{
+				ReaderOrientation result{};
+				if (apply_orientation)
+				{
+					switch (frame.orientation)
+					{
+					case Orientation::TopRight: result.flip_x = true; break;
+					case Orientation::BottomRight: result.flip_x = result.flip_y = true; break;
+					case Orientation::BottomLeft: result.flip_y = true; break;
+					case Orientation::LeftTop: result.transpose = true; break;
+					case Orientation::RightTop: result.transpose = result.flip_x = true; break;
+					case Orientation::RightBottom: result.transpose = result.flip_x = result.flip_y = true; break;
+					case Orientation::LeftBottom: result.transpose = result.flip_y = true; break;
+					default: break;
+					}
+				}
+				return result;
+			}
+
+			// width and height of the frame as displayed
+			Vec2ul display_size(const ReaderFrame& frame) const
+			{
+				return frame_orientation(frame).transpose ? Vec2ul{ frame.height, frame.width } : Vec2ul{ frame.width, frame.height };
+			}
+
+			// the stored rectangle shown in `target` of the displayed frame
+			static Rect stored_rect(const ReaderOrientation& orientation, uint32_t width, uint32_t height, const Rect& target)
+			{
+				const uint32_t across = orientation.transpose ? height : width;
+				const uint32_t down = orientation.transpose ? width : height;
+				Rect result = target;
+				if (orientation.flip_x)
+				{
+					result.x = across - target.x - target.width;
+				}
+				if (orientation.flip_y)
+				{
+					result.y = down - target.y - target.height;
+				}
+				if (orientation.transpose)
+				{
+					std::swap(result.x, result.y);
+					std::swap(result.width, result.height);
+				}
+				return result;
+			}
+
+			// the strides of `output` for a width x height region of `samples` samples of bytes_per_sample, with the packed ones filled in
+			static OutputLayout resolve_output(const OutputLayout& output, uint32_t width, uint32_t height, uint32_t bytes_per_sample,
+				uint32_t samples = 1)
+			{
+				OutputLayout result = output;
+				if (result.column_stride == 0)
+				{
+					result.column_stride = bytes_per_sample;
+				}
+				if (result.row_stride == 0)
+				{
+					result.row_stride = result.column_stride * width;
+				}
+				if (result.sample_stride == 0)
+				{
+					result.sample_stride = std::max(result.row_stride * height, result.column_stride * width);
+				}
+				if (result.frame_stride == 0)
+				{
+					result.frame_stride = std::max({ result.sample_stride * samples, result.row_stride * height, result.column_stride * width });
+				}
+				return result;
+			}
+
+			// writes `rows` stored rows of `cols` samples, starting at stored (x, y) of a width x height image,
+			// to where they are displayed in `dst`, which holds the displayed rectangle `target` with the strides of `output`
+			static void place_rows(const ReaderOrientation& orientation, uint32_t width, uint32_t height, const Rect& target,
+				const uint8_t* src, uint32_t x, uint32_t y, uint32_t cols, uint32_t rows, uint8_t* dst, const OutputLayout& output,
+				uint32_t bytes_per_sample)
+			{
+				const int64_t a = orientation.transpose ? y : x;
+				const int64_t b = orientation.transpose ? x : y;
+				const int64_t across = orientation.transpose ? height : width;
+				const int64_t down = orientation.transpose ? width : height;
+				const int64_t u = orientation.flip_x ? across - 1 - a : a;
+				const int64_t v = orientation.flip_y ? down - 1 - b : b;
+				const int64_t at = (v - target.y) * static_cast<int64_t>(output.row_stride) + (u - target.x) * static_cast<int64_t>(output.column_stride);
+
+				const ptrdiff_t column_step = static_cast<ptrdiff_t>(output.column_stride / bytes_per_sample);
+				const ptrdiff_t row_step = static_cast<ptrdiff_t>(output.row_stride / bytes_per_sample);
+				const ptrdiff_t along_x = orientation.flip_x ? -column_step : column_step;
+				const ptrdiff_t along_y = orientation.flip_y ? -row_step : row_step;
+				util::place_samples(bytes_per_sample, src, cols, rows, dst + at,
+					orientation.transpose ? along_y : along_x, orientation.transpose ? along_x : along_y);
+			}
+
+			// expanded palette images have a red, a green and a blue sample, converted CMYK ones lose the black
+			uint32_t decoded_samples(const ReaderFrame& frame) const
+			{
+				if (expands_palette(frame))
+				{
+					return 3;
+				}
+				return color_stage(frame) == ColorStage::CMYK ? frame.samples_per_pixel - 1u : frame.samples_per_pixel;
+			}
+
+			// the bits of a sample decoded from the file, before any conversion. converted halves are widened first
+			uint32_t native_bits(const ReaderFrame& frame) const
+			{
+				if (expands_palette(frame))
+				{
+					return 16;
+				}
+				if ((half_float == HalfFloat::Float || conversion.has_value())
+					&& frame.sample_format == SampleFormat::Float && frame.bits_per_sample == 16)
+				{
+					return 32;
+				}
+				return util::decoded_bits(frame.bits_per_sample);
+			}
+
+			// the bits and format of the samples handed out
+			uint32_t decoded_bits(const ReaderFrame& frame) const
+			{
+				return conversion.has_value() ? conversion->bits_per_sample : native_bits(frame);
+			}
+
+			SampleFormat decoded_format(const ReaderFrame& frame) const
+			{
+				if (conversion.has_value())
+				{
+					return conversion->sample_format;
+				}
+				return expands_palette(frame) ? SampleFormat::Uint : frame.sample_format;
+			}
+
+			ReaderBlockLayout block_layout(const ReaderFrame& frame, uint16_t sample) const
+			{
+				ReaderBlockLayout layout{};
+				const bool planar = frame.samples_per_pixel > 1 && frame.planar_config == PlanarConfiguration::Planar;
+				const bool palette = expands_palette(frame);
+				// every channel of an expanded palette image comes from the one sample of indices
+				if (palette)
+				{
+					layout.palette = frame.color_map.data() + (static_cast<size_t>(sample) << frame.bits_per_sample);
+					sample = 0;
+				}
+				const SampleFormat native_format = palette ? SampleFormat::Uint : frame.sample_format;
+
+				// red, green and blue are made from all samples of a pixel, the extra samples after them are read as they are
+				const ColorStage color = color_stage(frame);
+				if ((color == ColorStage::YCbCr || color == ColorStage::CMYK) && sample < 3)
+				{
+					layout.color = color;
+					if (color == ColorStage::YCbCr)
+					{
+						// the default luma coefficients of the TIFF spec (ITU-R BT.601) and full range ReferenceBlackWhite
+						constexpr float luma_red = 0.299f;
+						constexpr float luma_green = 0.587f;
+						constexpr float luma_blue = 0.114f;
+						const float cr_red = 2.0f - 2.0f * luma_red;
+						const float cb_blue = 2.0f - 2.0f * luma_blue;
+						layout.cb_factor = (sample == 0) ? 0.0f : (sample == 1) ? -luma_blue * cb_blue / luma_green : cb_blue;
+						layout.cr_factor = (sample == 0) ? cr_red : (sample == 1) ? -luma_red * cr_red / luma_green : 0.0f;
+						layout.unit_width = frame.ycbcr_subsampling_h;
+						layout.unit_height = frame.ycbcr_subsampling_v;
+					}
+					else
+					{
+						layout.color_ink = sample;
+					}
+				}
+				else if (color == ColorStage::Invert && sample == 0)
+				{
+					layout.color = color;
+				}
+				else if (color == ColorStage::CMYK)
+				{
+					sample += 1;
+				}
+				const bool whole_pixel = layout.color == ColorStage::YCbCr || layout.color == ColorStage::CMYK;
+
+				layout.bytes_per_sample = decoded_bits(frame) / 8;
+				layout.sample_bytes = native_bits(frame) / 8;
+				layout.bits = frame.bits_per_sample;
+				layout.pixel_bits = planar ? layout.bits : layout.bits * frame.samples_per_pixel;
+				if (layout.unit_width * layout.unit_height > 1)
+				{
+					// a unit is its lumas followed by one Cb and one Cr
+					layout.pixel_bits = layout.bits * (layout.unit_width * layout.unit_height + 2);
+				}
+				layout.sample_bit_offset = (planar || whole_pixel) ? 0 : layout.bits * sample;
+				layout.half_to_float = !palette && layout.bits == 16 && layout.sample_bytes == 4;
+				layout.stored_bytes = layout.half_to_float ? 2 : util::decoded_bits(layout.bits) / 8;
+				layout.packed = layout.bits != layout.stored_bytes * 8;
+				layout.fill_reversed = frame.fill_order == FillOrder::Reverse;
+				layout.is_signed = !palette && frame.sample_format == SampleFormat::Int;
+				if (layout.packed)
+				{
+					layout.unpack = pick_unpack(layout, file.file_byte_order == ByteOrder::LittleEndian);
+				}
+				else
+				{
+					layout.extract = util::pick_extract(layout.stored_bytes, layout.pixel_bits / layout.bits,
+						file.system_byte_order != file.file_byte_order);
+				}
+
+				if (conversion.has_value())
+				{
+					layout.convert = util::pick_conversion(layout.sample_bytes * 8, native_format,
+						conversion->bits_per_sample, conversion->sample_format);
+					layout.scale = conversion->scale;
+					layout.offset = conversion->offset;
+					if (conversion->normalize)
+					{
+						auto range = std::make_pair(conversion->range_min, conversion->range_max);
+						if (range.first == range.second)
+						{
+							range = util::sample_range(palette ? 16 : layout.bits, native_format);
+						}
+						// (in - min) / (max - min) * scale + offset
+						const double k = conversion->scale / (range.second - range.first);
+						layout.scale = k;
+						layout.offset = conversion->offset - range.first * k;
+					}
+				}
+
+				if (frame.is_tiled)
+				{
+					layout.block_width = frame.tile_width;
+					layout.block_height = frame.tile_length;
+					layout.offsets = &frame.tile_offsets;
+					layout.byte_counts = &frame.tile_byte_counts;
+				}
+				else
+				{
+					layout.block_width = frame.width;
+					layout.block_height = (frame.rows_per_strip == 0 || frame.rows_per_strip > frame.height)
+						? frame.height : frame.rows_per_strip;
+					layout.offsets = &frame.strip_offsets;
+					layout.byte_counts = &frame.strip_byte_counts;
+				}
+				layout.blocks_across = (frame.width + layout.block_width - 1) / layout.block_width;
+				layout.blocks_down = (frame.height + layout.block_height - 1) / layout.block_height;
+				layout.first_block = planar ? sample * layout.blocks_across * layout.blocks_down : 0;
+				layout.row_bytes = static_cast<uint32_t>((static_cast<uint64_t>((layout.block_width + layout.unit_width - 1) / layout.unit_width)
+					* layout.pixel_bits + 7) / 8);
+				return layout;
+			}
+
+			typedef void (*unpack_samples_t)(const uint8_t* src, size_t src_bytes, uint64_t bit, uint8_t* dst, uint32_t count, const ReaderBlockLayout& layout);
+
+			// a big endian 64 bit window with the sample `bit` bits into `src` in its high bits, `guarded` for the end of `src`
+			template<bool reversed, bool guarded>
+			static uint64_t bit_window(const uint8_t* src, size_t src_bytes, uint64_t bit)
+			{
+				const size_t byte = static_cast<size_t>(bit >> 3);
+				uint64_t window = 0;
+				for (uint32_t k = 0; k < 8; ++k)
+				{
+					window = (window << 8) | ((!guarded || byte + k < src_bytes) ? src[byte + k] : 0);
+				}
+				if constexpr (reversed)
+				{
+					window = util::reverse_bits_of_bytes(window);
+				}
+				return window << (bit & 7);
+			}
+
+			// packed samples of any depth one every pixel_bits of a bit stream, first sample in the high bits
+			// (reversed in each byte with FillOrder 2). samples whose window lies within `src` skip the bounds checks
+			template<typename out_t, bool reversed, bool is_signed>
+			TIFF_CXX_KERNEL static void unpack_stream(const uint8_t* src, size_t src_bytes, uint64_t bit, uint8_t* dst, uint32_t count, const ReaderBlockLayout& layout)
+			{
+				out_t* out = (out_t*)dst;
+				const uint32_t shift = 64 - layout.bits;
+				const uint64_t sign = uint64_t(1) << (layout.bits - 1);
+				auto sample = [&](uint64_t window)
+				{
+					uint64_t v = window >> shift;
+					if constexpr (is_signed)
+					{
+						v = (v ^ sign) - sign;
+					}
+					return out_t(v);
+				};
+
+				uint64_t unguarded = 0;
+				if (src_bytes >= 8 && (src_bytes - 8) * 8 >= bit)
+				{
+					unguarded = ((src_bytes - 8) * 8 - bit) / layout.pixel_bits + 1;
+				}
+				const uint32_t fast = static_cast<uint32_t>(std::min<uint64_t>(unguarded, count));
+				uint32_t i = 0;
+				for (; i < fast; ++i, bit += layout.pixel_bits)
+				{
+					out[i] = sample(bit_window<reversed, false>(src, src_bytes, bit));
+				}
+				for (; i < count; ++i, bit += layout.pixel_bits)
+				{
+					out[i] = sample(bit_window<reversed, true>(src, src_bytes, bit));
+				}
+			}
+
+			// sample k of a group of 8 neighbouring `bits` wide samples, which take `bits` bytes
+			template<uint32_t bits, uint32_t k>
+			static uint16_t group_sample(const uint8_t* group)
+			{
+				constexpr uint32_t byte = k * bits / 8;
+				constexpr uint32_t end = k * bits % 8 + bits;
+				uint32_t w = (uint32_t(group[byte]) << 16) | (uint32_t(group[byte + 1]) << 8);
+				if constexpr (end > 16)
+				{
+					w |= group[byte + 2];
+				}
+				return uint16_t((w >> (24 - end)) & ((1u << bits) - 1));
+			}
+
+			template<uint32_t bits, size_t... k>
+			static void unpack_group(const uint8_t* group, uint16_t* out, std::index_sequence<k...>)
+			{
+				((out[k] = group_sample<bits, uint32_t(k)>(group)), ...);
+			}
+
+			// neighbouring unsigned 10, 12 or 14 bit samples, 8 at a time with every shift known at compile time
+			template<uint32_t bits>
+			TIFF_CXX_KERNEL static void unpack_fixed(const uint8_t* src, size_t src_bytes, uint64_t bit, uint8_t* dst, uint32_t count, const ReaderBlockLayout&)
+			{
+				uint16_t* out = (uint16_t*)dst;
+				uint32_t i = 0;
+				for (; i < count && (bit & 7) != 0; ++i, bit += bits)
+				{
+					out[i] = uint16_t(bit_window<false, true>(src, src_bytes, bit) >> (64 - bits));
+				}
+				const uint8_t* group = src + (bit >> 3);
+				for (; i + 8 <= count; i += 8, group += bits, bit += 8 * bits)
+				{
+					unpack_group<bits>(group, out + i, std::make_index_sequence<8>{});
+				}
+				for (; i < count; ++i, bit += bits)
+				{
+					out[i] = uint16_t(bit_window<false, true>(src, src_bytes, bit) >> (64 - bits));
+				}
+			}
+
+			// neighbouring unsigned 1, 2 or 4 bit samples, a byte at a time from a table
+			template<uint32_t bits>
+			TIFF_CXX_KERNEL static void unpack_table(const uint8_t* src, size_t src_bytes, uint64_t bit, uint8_t* dst, uint32_t count, const ReaderBlockLayout& layout)
+			{
+				constexpr uint32_t per_byte = 8 / bits;
+				auto single = [&](uint64_t at)
+				{
+					const uint64_t window = layout.fill_reversed
+						? bit_window<true, true>(src, src_bytes, at) : bit_window<false, true>(src, src_bytes, at);
+					return uint8_t(window >> (64 - bits));
+				};
+				uint32_t i = 0;
+				for (; i < count && (bit & 7) != 0; ++i, bit += bits)
+				{
+					dst[i] = single(bit);
+				}
+				const auto& values = util::sub_byte_table<bits>().values[layout.fill_reversed ? 1 : 0];
+				const uint8_t* bytes = src + (bit >> 3);
+				for (; i + per_byte <= count; i += per_byte, ++bytes, bit += 8)
+				{
+					std::memcpy(dst + i, values[*bytes], per_byte);
+				}
+				for (; i < count; ++i, bit += bits)
+				{
+					dst[i] = single(bit);
+				}
+			}
+
+			// 24 bit samples, in the file byte order
+			template<bool little_endian, bool reversed, bool is_signed>
+			TIFF_CXX_KERNEL static void unpack_24(const uint8_t* src, size_t, uint64_t bit, uint8_t* dst, uint32_t count, const ReaderBlockLayout& layout)
+			{
+				uint32_t* out = (uint32_t*)dst;
+				const uint8_t* p = src + (bit >> 3);
+				const size_t step = layout.pixel_bits / 8;
+				for (uint32_t i = 0; i < count; ++i, p += step)
+				{
+					uint32_t b0 = p[0];
+					uint32_t b1 = p[1];
+					uint32_t b2 = p[2];
+					if constexpr (reversed)
+					{
+						b0 = util::reverse_bits(uint8_t(b0));
+						b1 = util::reverse_bits(uint8_t(b1));
+						b2 = util::reverse_bits(uint8_t(b2));
+					}
+					uint32_t v = little_endian ? (b0 | (b1 << 8) | (b2 << 16)) : ((b0 << 16) | (b1 << 8) | b2);
+					if constexpr (is_signed)
+					{
+						v = (v ^ 0x800000u) - 0x800000u;
+					}
+					out[i] = v;
+				}
+			}
+
+			template<typename out_t>
+			static unpack_samples_t pick_unpack_stream(const ReaderBlockLayout& layout)
+			{
+				if (layout.fill_reversed)
+				{
+					return layout.is_signed ? &unpack_stream<out_t, true, true> : &unpack_stream<out_t, true, false>;
+				}
+				return layout.is_signed ? &unpack_stream<out_t, false, true> : &unpack_stream<out_t, false, false>;
+			}
+
+			template<bool little_endian>
+			static unpack_samples_t pick_unpack_24(const ReaderBlockLayout& layout)
+			{
+				if (layout.fill_reversed)
+				{
+					return layout.is_signed ? &unpack_24<little_endian, true, true> : &unpack_24<little_endian, true, false>;
+				}
+				return layout.is_signed ? &unpack_24<little_endian, false, true> : &unpack_24<little_endian, false, false>;
+			}
+
+			// the kernel for packed samples of a frame
+			static unpack_samples_t pick_unpack(const ReaderBlockLayout& layout, bool little_endian)
+			{
+				if (layout.pixel_bits == layout.bits && !layout.is_signed)
+				{
+					switch (layout.bits)
+					{
+					case 1: return &unpack_table<1>;
+					case 2: return &unpack_table<2>;
+					case 4: return &unpack_table<4>;
+					case 10: if (!layout.fill_reversed) { return &unpack_fixed<10>; } break;
+					case 12: if (!layout.fill_reversed) { return &unpack_fixed<12>; } break;
+					case 14: if (!layout.fill_reversed) { return &unpack_fixed<14>; } break;
+					default: break;
+					}
+				}
+				if (layout.bits == 24)
+				{
+					return little_endian ? pick_unpack_24<true>(layout) : pick_unpack_24<false>(layout);
+				}
+				switch (layout.stored_bytes)
+				{
+				case 1: return pick_unpack_stream<uint8_t>(layout);
+				case 2: return pick_unpack_stream<uint16_t>(layout);
+				default: return pick_unpack_stream<uint32_t>(layout);
+				}
+			}
+
+			// moves `bit` (and the column in a subsampling unit) `pixels` pixels on
+			static void skip_pixels(uint64_t& bit, uint32_t& unit_x, uint32_t pixels, const ReaderBlockLayout& layout)
+			{
+				const uint32_t p = unit_x + pixels;
+				bit += static_cast<uint64_t>(p / layout.unit_width) * layout.pixel_bits;
+				unit_x = p % layout.unit_width;
+			}
+
+			// writes `count` samples of a block row, from `bit` bits into `row` on, as decoded samples in host byte order.
+			// subsampled rows start in column unit_x and row unit_y of the unit at `bit`
+			void decode_samples(const uint8_t* row, size_t row_span, uint64_t bit, uint8_t* dst, uint32_t count, const ReaderBlockLayout& layout,
+				uint32_t unit_x = 0, uint32_t unit_y = 0) const
+			{
+				if (layout.convert == nullptr)
+				{
+					decode_native(row, row_span, bit, dst, count, layout, unit_x, unit_y);
+					return;
+				}
+				// converted from a small buffer which stays in cache
+				alignas(8) uint8_t native[8 * 1024];
+				const uint32_t chunk = static_cast<uint32_t>(sizeof(native) / layout.sample_bytes);
+				for (uint32_t done = 0; done < count;)
+				{
+					const uint32_t n = std::min(count - done, chunk);
+					decode_native(row, row_span, bit, native, n, layout, unit_x, unit_y);
+					layout.convert(native, dst + static_cast<size_t>(done) * layout.bytes_per_sample, n, layout.scale, layout.offset);
+					skip_pixels(bit, unit_x, n, layout);
+					done += n;
+				}
+			}
+
+			// the samples before any conversion: as stored and only widened, looked up in the color map or made from all samples of the pixel
+			void decode_native(const uint8_t* row, size_t row_span, uint64_t bit, uint8_t* dst, uint32_t count, const ReaderBlockLayout& layout,
+				uint32_t unit_x, uint32_t unit_y) const
+			{
+				if (layout.color != ColorStage::None)
+				{
+					if (layout.stored_bytes == 1)
+					{
+						decode_color<uint8_t>(row, row_span, bit, (uint8_t*)dst, count, layout, unit_x, unit_y);
+					}
+					else
+					{
+						decode_color<uint16_t>(row, row_span, bit, (uint16_t*)dst, count, layout, unit_x, unit_y);
+					}
+					return;
+				}
+				if (layout.palette != nullptr)
+				{
+					// the indices go through a small buffer which stays in cache
+					alignas(8) uint8_t indices[8 * 1024];
+					const uint32_t chunk = static_cast<uint32_t>(sizeof(indices) / layout.stored_bytes);
+					for (uint32_t done = 0; done < count;)
+					{
+						const uint32_t n = std::min(count - done, chunk);
+						decode_stored(row, row_span, bit + static_cast<uint64_t>(done) * layout.pixel_bits, indices, n, layout);
+						if (layout.stored_bytes == 1)
+						{
+							util::expand_palette(indices, layout.palette, (uint16_t*)dst + done, n);
+						}
+						else
+						{
+							util::expand_palette((const uint16_t*)indices, layout.palette, (uint16_t*)dst + done, n);
+						}
+						done += n;
+					}
+					return;
+				}
+				decode_stored(row, row_span, bit, dst, count, layout);
+			}
+
+			// the stored samples of the pixels are de-interleaved into small buffers which stay in cache and converted from there
+			template<typename value_t>
+			void decode_color(const uint8_t* row, size_t row_span, uint64_t bit, value_t* dst, uint32_t count, const ReaderBlockLayout& layout,
+				uint32_t unit_x, uint32_t unit_y) const
+			{
+				if (layout.color == ColorStage::Invert)
+				{
+					decode_stored(row, row_span, bit, (uint8_t*)dst, count, layout);
+					util::invert_samples(dst, count, layout.bits);
+					return;
+				}
+
+				constexpr uint32_t chunk = 2048;
+				value_t components[3][chunk];
+				for (uint32_t done = 0; done < count;)
+				{
+					const uint32_t n = std::min(count - done, chunk);
+					if (layout.color == ColorStage::CMYK)
+					{
+						decode_stored(row, row_span, bit + static_cast<uint64_t>(layout.color_ink) * layout.bits, (uint8_t*)components[0], n, layout);
+						decode_stored(row, row_span, bit + static_cast<uint64_t>(3) * layout.bits, (uint8_t*)components[1], n, layout);
+						util::cmyk_to_rgb(components[0], components[1], dst + done, n, layout.bits);
+					}
+					else
+					{
+						if (layout.unit_width * layout.unit_height > 1)
+						{
+							gather_ycbcr(row + (bit >> 3), unit_x, unit_y, n, layout, components);
+						}
+						else
+						{
+							for (uint32_t c = 0; c < 3; ++c)
+							{
+								decode_stored(row, row_span, bit + static_cast<uint64_t>(c) * layout.bits, (uint8_t*)components[c], n, layout);
+							}
+						}
+						util::ycbcr_to_rgb(components[0], components[1], components[2], dst + done, n, layout.cb_factor, layout.cr_factor, layout.bits);
+					}
+					skip_pixels(bit, unit_x, n, layout);
+					done += n;
+				}
+			}
+
+			// Y, Cb and Cr of `count` pixels of 8 bit subsampled units, from column unit_x and row unit_y of the first unit on
+			template<typename value_t, size_t chunk>
+			static void gather_ycbcr(const uint8_t* units, uint32_t unit_x, uint32_t unit_y, uint32_t count, const ReaderBlockLayout& layout,
+				value_t (&components)[3][chunk])
+			{
+				const uint32_t width = layout.unit_width;
+				const size_t unit_bytes = layout.pixel_bits / 8;
+				const uint32_t luma = unit_y * width;
+				const uint32_t chroma = width * layout.unit_height;
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					const uint32_t p = unit_x + i;
+					const uint8_t* unit = units + (p / width) * unit_bytes;
+					components[0][i] = unit[luma + p % width];
+					components[1][i] = unit[chroma];
+					components[2][i] = unit[chroma + 1];
+				}
+			}
+
+			// the samples as stored, only widened
+			void decode_stored(const uint8_t* row, size_t row_span, uint64_t bit, uint8_t* dst, uint32_t count, const ReaderBlockLayout& layout) const
+			{
+				if (layout.half_to_float)
+				{
+					// through a small buffer which stays in cache
+					uint16_t halves[1024];
+					const uint32_t stride = layout.pixel_bits / 8;
+					for (uint32_t done = 0; done < count;)
+					{
+						const uint32_t n = std::min<uint32_t>(count - done, uint32_t(std::size(halves)));
+						layout.extract(row + (bit >> 3) + static_cast<size_t>(done) * stride, (uint8_t*)halves, n, stride);
+						util::half_to_float(halves, (float*)dst + done, n);
+						done += n;
+					}
+					return;
+				}
+				if (layout.packed)
+				{
+					layout.unpack(row, row_span, bit, dst, count, layout);
+					return;
+				}
+				layout.extract(row + (bit >> 3), dst, count, layout.pixel_bits / 8);
+			}
+
+			// points every block at its bytes. sources holding the file in memory are used in place, for the others
+			// the blocks are read into `raw` and those following each other in the file are merged into reads of up to max_read_size
+			Error read_blocks(std::vector<ReaderBlock>& blocks, std::vector<uint8_t>& raw)
+			{
+				std::vector<size_t> copied{};
+				size_t raw_bytes = 0;
+				for (size_t i = 0; i < blocks.size(); ++i)
+				{
+					auto& block = blocks[i];
+					block.data = (block.size == block.span) ? file.source->data_at(block.offset, block.span) : nullptr;
+					if (block.data == nullptr)
+					{
+						block.buffer_offset = raw_bytes;
+						raw_bytes += block.span;
+						copied.emplace_back(i);
+					}
+				}
+				raw.resize(raw_bytes);
+				for (size_t i : copied)
+				{
+					blocks[i].data = raw.data() + blocks[i].buffer_offset;
+				}
+
+				std::vector<ReadRequest> runs{};
+				std::vector<size_t> run_ends{};
+				size_t i = 0;
+				while (i < copied.size())
+				{
+					size_t end = i + 1;
+					uint64_t run_bytes = blocks[copied[i]].size;
+					while (end < copied.size())
+					{
+						const auto& last = blocks[copied[end - 1]];
+						const auto& next = blocks[copied[end]];
+						if (last.size != last.span || next.offset != last.offset + last.size
+							|| run_bytes + next.size > max_read_size)
+						{
+							break;
+						}
+						run_bytes += next.size;
+						++end;
+					}
+
+					ReadRequest run{};
+					run.offset = blocks[copied[i]].offset;
+					run.size = run_bytes;
+					run.data = raw.data() + blocks[copied[i]].buffer_offset;
+					runs.emplace_back(run);
+					run_ends.emplace_back(end);
+					i = end;
+				}
+
+				if (!runs.empty())
+				{
+					file.source->read_batch(runs);
+				}
+
+				Error err = Error::NoError;
+				i = 0;
+				for (size_t r = 0; r < runs.size(); ++r)
+				{
+					const size_t run_begin = blocks[copied[i]].buffer_offset;
+					for (; i < run_ends[r]; ++i)
+					{
+						const auto& block = blocks[copied[i]];
+						const uint64_t block_start = block.buffer_offset - run_begin;
+						const uint64_t got = std::min<uint64_t>(block.size,
+							runs[r].result > block_start ? runs[r].result - block_start : 0);
+						if (got != block.span)
+						{
+							uint8_t* dst = raw.data() + block.buffer_offset;
+							std::fill(dst + got, dst + block.span, uint8_t(0));
+							err = Error::StripDataLost;
+						}
+					}
+				}
+				return err;
+			}
+
+			// adds the blocks holding the rows of `region` from `y` on, about `budget` bytes of them but at least one row,
+			// and moves `y` past those rows
+			static void band_blocks(const ReaderBlockLayout& layout, const Rect& region, uint32_t& y, uint64_t budget, std::vector<ReaderBlock>& blocks)
+			{
+				const uint32_t region_end = region.y + region.height;
+				const uint32_t bx_begin = region.x / layout.block_width;
+				const uint32_t bx_end = (region.x + region.width - 1) / layout.block_width + 1;
+				const uint64_t row_cost = static_cast<uint64_t>(bx_end - bx_begin) * layout.row_bytes;
+
+				uint64_t band_bytes = 0;
+				while (y < region_end && (band_bytes == 0 || band_bytes < budget))
+				{
+					const uint32_t by = y / layout.block_height;
+					const uint32_t block_top = by * layout.block_height;
+					const uint64_t budget_rows = std::max<uint64_t>(1, (budget - std::min(band_bytes, budget)) / row_cost);
+					const uint32_t rows_end = static_cast<uint32_t>(std::min<uint64_t>({
+						static_cast<uint64_t>(block_top) + layout.block_height, region_end, y + std::min<uint64_t>(budget_rows, region_end - y) }));
+
+					for (uint32_t bx = bx_begin; bx < bx_end; ++bx)
+					{
+						const uint32_t index = layout.first_block + by * layout.blocks_across + bx;
+						const uint32_t block_left = bx * layout.block_width;
+
+						ReaderBlock block{};
+						block.row_begin = y;
+						block.row_end = rows_end;
+						block.col_begin = std::max(region.x, block_left);
+						block.col_end = std::min(region.x + region.width, block_left + layout.block_width);
+
+						// from the first needed sample of the first row to the last needed sample of the last row
+						const uint64_t first = static_cast<uint64_t>((y - block_top) / layout.unit_height) * layout.row_bytes
+							+ static_cast<uint64_t>((block.col_begin - block_left) / layout.unit_width) * layout.pixel_bits / 8;
+						const uint64_t last = static_cast<uint64_t>((rows_end - 1 - block_top) / layout.unit_height) * layout.row_bytes
+							+ (static_cast<uint64_t>((block.col_end - block_left + layout.unit_width - 1) / layout.unit_width) * layout.pixel_bits + 7) / 8;
+						const uint64_t available = (*layout.byte_counts)[index];
+
+						block.offset = (*layout.offsets)[index] + first;
+						block.span = static_cast<uint32_t>(last - first);
+						block.size = static_cast<uint32_t>(std::min<uint64_t>(block.span, available > first ? available - first : 0));
+						band_bytes += block.span;
+						blocks.emplace_back(block);
+					}
+					y = rows_end;
+				}
+			}
+
+			// decodes the rows [band_begin, band_end) of `region` from the blocks [blocks, blocks_end) which were read,
+			// into `direct` like decode_region does or to sink. `band` is the scratch for bands which are not decoded in place.
+			// only reads the reader, so frames can be decoded on several threads at once
+			template<typename sink_t>
+			void decode_band(const ReaderFrame& frame, const ReaderBlockLayout& layout, const ReaderOrientation& orientation,
+				const Rect& target, const Rect& region, const OutputLayout& strides, const ReaderBlock* blocks, const ReaderBlock* blocks_end,
+				uint32_t band_begin, uint32_t band_end, uint8_t* direct, std::vector<uint8_t>& band, SampleStatistics* statistics, sink_t& sink) const
+			{
+				// rows with packed columns are decoded right into their displayed row (and reversed there when mirrored),
+				// transposed or strided bands are decoded in stored order and placed where they are displayed
+				const bool in_place = direct != nullptr && !orientation.transpose && strides.column_stride == layout.bytes_per_sample;
+				const uint32_t region_end = region.y + region.height;
+				const size_t out_row_bytes = static_cast<size_t>(region.width) * layout.bytes_per_sample;
+
+				// row `row` of the band goes to band_data + (row - band_begin) * band_step
+				uint8_t* band_data = direct;
+				ptrdiff_t band_step = static_cast<ptrdiff_t>(in_place ? strides.row_stride : out_row_bytes);
+				if (in_place && orientation.flip_y)
+				{
+					band_data += static_cast<size_t>(region_end - 1 - band_begin) * strides.row_stride;
+					band_step = -band_step;
+				}
+				else if (in_place)
+				{
+					band_data += static_cast<size_t>(band_begin - region.y) * strides.row_stride;
+				}
+				else
+				{
+					band.resize(static_cast<size_t>(band_end - band_begin) * out_row_bytes);
+					band_data = band.data();
+				}
+
+				for (const ReaderBlock* block = blocks; block != blocks_end; ++block)
+				{
+					// every row starts as many bits into its first byte as the first one
+					const uint32_t col = block->col_begin % layout.block_width;
+					const uint64_t bit = static_cast<uint64_t>(col / layout.unit_width) * layout.pixel_bits % 8
+						+ layout.sample_bit_offset;
+					const uint32_t block_top = block->row_begin - block->row_begin % layout.block_height;
+					const uint32_t first_unit_row = (block->row_begin - block_top) / layout.unit_height;
+					for (uint32_t row = block->row_begin; row < block->row_end; ++row)
+					{
+						const size_t row_offset = static_cast<size_t>((row - block_top) / layout.unit_height - first_unit_row) * layout.row_bytes;
+						decode_samples(block->data + row_offset, block->span - row_offset, bit,
+							band_data + static_cast<ptrdiff_t>(row - band_begin) * band_step + static_cast<size_t>(block->col_begin - region.x) * layout.bytes_per_sample,
+							block->col_end - block->col_begin, layout, col % layout.unit_width, (row - block_top) % layout.unit_height);
+					}
+				}
+
+				if (in_place && orientation.flip_x)
+				{
+					for (uint32_t row = band_begin; row < band_end; ++row)
+					{
+						util::reverse_samples(layout.bytes_per_sample, band_data + static_cast<ptrdiff_t>(row - band_begin) * band_step, region.width);
+					}
+				}
+
+				if (statistics != nullptr)
+				{
+					// the rows of the band are together unless they are padded, from the last one on when they are upside down
+					const uint8_t* band_first = (band_step < 0) ? band_data + static_cast<ptrdiff_t>(band_end - 1 - band_begin) * band_step : band_data;
+					const bool together = static_cast<size_t>(band_step < 0 ? -band_step : band_step) == out_row_bytes;
+					util::visit_sample_type(decoded_bits(frame), decoded_format(frame), [&](auto type)
+					{
+						typedef decltype(type) value_t;
+						if (together)
+						{
+							util::accumulate_statistics((const value_t*)band_first, static_cast<size_t>(band_end - band_begin) * region.width, *statistics);
+							return;
+						}
+						for (uint32_t row = band_begin; row < band_end; ++row)
+						{
+							util::accumulate_statistics((const value_t*)(band_data + static_cast<ptrdiff_t>(row - band_begin) * band_step),
+								region.width, *statistics);
+						}
+					});
+				}
+
+				if (direct != nullptr && !in_place)
+				{
+					place_rows(orientation, frame.width, frame.height, target, band_data, region.x, band_begin,
+						region.width, band_end - band_begin, direct, strides, layout.bytes_per_sample);
+				}
+				else if (direct == nullptr)
+				{
+					for (uint32_t row = band_begin; row < band_end; ++row)
+					{
+						sink(row, band_data + static_cast<size_t>(row - band_begin) * out_row_bytes);
+					}
+				}
+			}
+
+			// streams the rows of `region` of one sample plane in bands of about max_read_size,
+			// every row holds region.width samples in host byte order and goes to sink(y, row),
+			// or straight into `direct` (a region sized buffer with the strides of `output`) when it is given.
+			// a region read into `direct` is in display order when orientation is applied, rows handed to sink are stored rows.
+			// `statistics` is updated per band while the decoded samples are still in cache
+			template<typename sink_t>
+			Error decode_region(const ReaderFrame& frame, uint16_t sample, const Rect& target, uint8_t* direct,
+				const OutputLayout& output, SampleStatistics* statistics, sink_t&& sink)
+			{
+				Error err = check_frame(frame);
+				if (err != Error::NoError)
+				{
+					return err;
+				}
+				if (sample >= decoded_samples(frame))
+				{
+					return Error::InvalidSampleIndex;
+				}
+				const ReaderOrientation orientation = (direct != nullptr) ? frame_orientation(frame) : ReaderOrientation{};
+				const uint32_t across = orientation.transpose ? frame.height : frame.width;
+				const uint32_t down = orientation.transpose ? frame.width : frame.height;
+				if (target.width == 0 || target.height == 0
+					|| static_cast<uint64_t>(target.x) + target.width > across
+					|| static_cast<uint64_t>(target.y) + target.height > down)
+				{
+					return Error::InvalidRegion;
+				}
+				const Rect region = stored_rect(orientation, frame.width, frame.height, target);
+
+				const ReaderBlockLayout layout = block_layout(frame, sample);
+				const uint32_t block_count = layout.first_block + layout.blocks_across * layout.blocks_down;
+				if (layout.offsets->size() < block_count || layout.byte_counts->size() < block_count)
+				{
+					return Error::StripDataLost;
+				}
+				const OutputLayout strides = resolve_output(output, target.width, target.height, layout.bytes_per_sample);
+
+				if (statistics != nullptr)
+				{
+					util::visit_sample_type(decoded_bits(frame), decoded_format(frame), [&](auto type)
+					{
+						util::reset_statistics<decltype(type)>(*statistics);
+					});
+				}
+
+				std::vector<ReaderBlock> blocks{};
+				std::vector<uint8_t> raw{};
+				std::vector<uint8_t> band{};
+
+				uint32_t y = region.y;
+				while (y < region.y + region.height)
+				{
+					const uint32_t band_begin = y;
+					blocks.clear();
+					band_blocks(layout, region, y, max_read_size, blocks);
+					if (read_blocks(blocks, raw) != Error::NoError)
+					{
+						err = Error::StripDataLost;
+					}
+					decode_band(frame, layout, orientation, target, region, strides, blocks.data(), blocks.data() + blocks.size(),
+						band_begin, y, direct, band, statistics, sink);
+				}
+
+				return err;
+			}
+
+			ReaderFrame* level_frame(uint32_t level) noexcept
+			{
+				if (level == 0)
+				{
+					return &file.current_frame;
+				}
+				if (level <= file.current_levels.size())
+				{
+					return &file.current_levels[level - 1];
+				}
+				return nullptr;
+			}
+
+			Error read_region(uint32_t level, uint16_t sample, const Rect& region, void* buffer, size_t buffer_size,
+				SampleStatistics* statistics)
+			{
+				ReaderFrame* frame = level_frame(level);
+				if (frame == nullptr)
+				{
+					return Error::LevelNotFound;
+				}
+				load_frame_tables(*frame);
+				if (buffer_size < static_cast<uint64_t>(region.width) * region.height * (decoded_bits(*frame) / 8))
+				{
+					return Error::BufferTooSmall;
+				}
+				const Vec2ul size = display_size(*frame);
+				if (region.width < size.x || region.height < size.y)
+				{
+					advise_pattern(AccessHint::Random);
+				}
+				return decode_region(*frame, sample, region, (uint8_t*)buffer, OutputLayout{}, statistics, [](uint32_t, const uint8_t*) {});
+			}
+
+			Error read_samples(uint32_t level, uint16_t first_sample, uint16_t sample_count, const Rect& region,
+				const OutputLayout& output, void* buffer, size_t buffer_size)
+			{
+				ReaderFrame* frame = level_frame(level);
+				if (frame == nullptr)
+				{
+					return Error::LevelNotFound;
+				}
+				load_frame_tables(*frame);
+				if (sample_count == 0 || static_cast<uint32_t>(first_sample) + sample_count > decoded_samples(*frame))
+				{
+					return Error::InvalidSampleIndex;
+				}
+				if (region.width == 0 || region.height == 0)
+				{
+					return Error::InvalidRegion;
+				}
+
+				// the kernels step sample by sample, so every stride is a whole number of samples
+				const uint32_t bytes_per_sample = decoded_bits(*frame) / 8;
+				const OutputLayout strides = resolve_output(output, region.width, region.height, bytes_per_sample);
+				if (strides.column_stride % bytes_per_sample != 0 || strides.row_stride % bytes_per_sample != 0
+					|| strides.sample_stride % bytes_per_sample != 0)
+				{
+					return Error::InvalidOutputLayout;
+				}
+				// the last sample written is the furthest one along every dimension
+				const double extent = double(region.width - 1) * strides.column_stride + double(region.height - 1) * strides.row_stride
+					+ double(sample_count - 1) * strides.sample_stride + bytes_per_sample;
+				if (double(buffer_size) < extent)
+				{
+					return Error::BufferTooSmall;
+				}
+
+				const Vec2ul size = display_size(*frame);
+				if (region.width < size.x || region.height < size.y)
+				{
+					advise_pattern(AccessHint::Random);
+				}
+				Error result = Error::NoError;
+				for (uint16_t i = 0; i < sample_count; ++i)
+				{
+					const Error err = decode_region(*frame, uint16_t(first_sample + i), region, (uint8_t*)buffer + i * strides.sample_stride,
+						strides, nullptr, [](uint32_t, const uint8_t*) {});
+					if (err == Error::StripDataLost)
+					{
+						result = err;
+					}
+					else if (err != Error::NoError)
+					{
+						return err;
+					}
+				}
+				return result;
+			}
+
+			template<typename value_t>
+			Error read_binned_typed(uint16_t sample, uint32_t factor, BinMode mode, uint8_t* buffer)
+			{
+				typedef util::sum_type_t<value_t> sum_t;
+
+				const ReaderFrame& frame = file.current_frame;
+				const uint32_t out_width = (frame.width + factor - 1) / factor;
+				std::vector<sum_t> sums(mode == BinMode::Sum || mode == BinMode::Mean ? out_width : 0);
+				std::vector<value_t> maxima(out_width);
+
+				return decode_region(frame, sample, Rect{ 0, 0, frame.width, frame.height }, nullptr, OutputLayout{}, nullptr, [&](uint32_t y, const uint8_t* data)
+				{
+					const value_t* row = (const value_t*)data;
+					const uint32_t bin_row = y % factor;
+					const size_t out_row = static_cast<size_t>(y / factor) * out_width;
+
+					if (mode == BinMode::Stride)
+					{
+						if (bin_row == 0)
+						{
+							value_t* out = (value_t*)buffer + out_row;
+							for (uint32_t x = 0; x < out_width; ++x)
+							{
+								out[x] = row[static_cast<size_t>(x) * factor];
+							}
+						}
+						return;
+					}
+
+					util::bin_row(row, frame.width, factor, sums.empty() ? nullptr : sums.data(), maxima.data(), bin_row == 0);
+					if (bin_row + 1 != factor && y + 1 != frame.height)
+					{
+						return;
+					}
+
+					if (mode == BinMode::Max)
+					{
+						std::copy(maxima.begin(), maxima.end(), (value_t*)buffer + out_row);
+					}
+					else if (mode == BinMode::Sum)
+					{
+						std::copy(sums.begin(), sums.end(), (sum_t*)buffer + out_row);
+					}
+					else
+					{
+						value_t* out = (value_t*)buffer + out_row;
+						const uint32_t rows = bin_row + 1;
+						for (uint32_t x = 0; x < out_width; ++x)
+						{
+							const sum_t n = sum_t(std::min(factor, frame.width - x * factor) * rows);
+							if constexpr (std::is_floating_point_v<value_t>)
+							{
+								out[x] = value_t(sums[x] / n);
+							}
+							else if constexpr (std::is_signed_v<value_t>)
+							{
+								out[x] = value_t((sums[x] + (sums[x] < 0 ? -n / 2 : n / 2)) / n);
+							}
+							else
+							{
+								out[x] = value_t((sums[x] + n / 2) / n);
+							}
+						}
+					}
+				});
+			}
+
+			Error read_binned(uint16_t sample, uint32_t factor, BinMode mode, void* buffer, size_t buffer_size)
+			{
+				load_frame_tables(file.current_frame);
+				const ReaderFrame& frame = file.current_frame;
+				Error err = check_frame(frame);
+				if (err != Error::NoError)
+				{
+					return err;
+				}
+				if (factor == 0)
+				{
+					return Error::InvalidBinFactor;
+				}
+
+				const uint64_t out_samples = static_cast<uint64_t>((frame.width + factor - 1) / factor) * ((frame.height + factor - 1) / factor);
+				const uint32_t out_bytes = (mode == BinMode::Sum) ? 8 : decoded_bits(frame) / 8;
+				if (buffer_size < out_samples * out_bytes)
+				{
+					return Error::BufferTooSmall;
+				}
+
+				// oriented frames are binned in stored order and the bins placed where they are displayed
+				const ReaderOrientation orientation = frame_orientation(frame);
+				std::vector<uint8_t> stored_bins(orientation.identity() ? 0 : static_cast<size_t>(out_samples) * out_bytes);
+				uint8_t* bins = orientation.identity() ? (uint8_t*)buffer : stored_bins.data();
+
+				if (!util::visit_sample_type(decoded_bits(frame), decoded_format(frame), [&](auto type)
+				{
+					err = read_binned_typed<decltype(type)>(sample, factor, mode, bins);
+				}))
+				{
+					return Error::InvalidBitPerSample;
+				}
+
+				if (!orientation.identity() && (err == Error::NoError || err == Error::StripDataLost))
+				{
+					const uint32_t bins_across = (frame.width + factor - 1) / factor;
+					const uint32_t bins_down = (frame.height + factor - 1) / factor;
+					const Rect target = orientation.transpose ? Rect{ 0, 0, bins_down, bins_across } : Rect{ 0, 0, bins_across, bins_down };
+					place_rows(orientation, bins_across, bins_down, target, bins, 0, 0, bins_across, bins_down, (uint8_t*)buffer,
+						resolve_output(OutputLayout{}, target.width, target.height, out_bytes), out_bytes);
+				}
+				return err;
+			}
+
+			template<typename value_t>
+			Error project_frames_typed(const ReaderFrame& reference, uint16_t sample, ProjectionMode mode,
+				uint32_t first, uint32_t count, uint8_t* buffer)
+			{
+				typedef util::sum_type_t<value_t> sum_t;
+
+				const size_t plane_size = static_cast<size_t>(reference.width) * reference.height;
+				std::vector<value_t> planes[2]{ std::vector<value_t>(plane_size), std::vector<value_t>(count > 1 ? plane_size : 0) };
+				std::vector<sum_t> sums(mode == ProjectionMode::Mean ? plane_size : 0);
+
+				// only the loading side touches the stream, the reducing side works on the decoded plane
+				auto load = [this, &reference, sample](uint32_t index, std::vector<value_t>* plane)
+				{
+					ReaderFrame frame{};
+					uint32_t next_offset = 0;
+					Error err = parse_frame(file.frame_ifds[index], frame, next_offset);
+					const Vec2ul size = display_size(frame);
+					const Vec2ul reference_size = display_size(reference);
+					if (err == Error::NoError
+						&& (size.x != reference_size.x || size.y != reference_size.y
+							|| frame.bits_per_sample != reference.bits_per_sample || frame.sample_format != reference.sample_format
+							|| frame.samples_per_pixel != reference.samples_per_pixel
+							|| decoded_bits(frame) != decoded_bits(reference) || decoded_format(frame) != decoded_format(reference)
+							|| decoded_samples(frame) != decoded_samples(reference)))
+					{
+						err = Error::InconsistentFrames;
+					}
+					if (err == Error::NoError)
+					{
+						err = decode_region(frame, sample, Rect{ 0, 0, uint32_t(size.x), uint32_t(size.y) }, (uint8_t*)plane->data(), OutputLayout{},
+							nullptr, [](uint32_t, const uint8_t*) {});
+						advise_frame(frame, AccessHint::DontNeed);
+					}
+					return err;
+				};
+
+				Error err = load(first, &planes[0]);
+				for (uint32_t i = 0; i < count && err == Error::NoError; ++i)
+				{
+					std::future<Error> next_plane{};
+					bool load_after = false;
+					if (i + 1 < count)
+					{
+						// without a thread to spare the next frame is read once this one is reduced
+						try
+						{
+							next_plane = std::async(std::launch::async, load, first + i + 1, &planes[(i + 1) % 2]);
+						}
+						catch (const std::system_error&)
+						{
+							load_after = true;
+						}
+					}
+
+					const value_t* plane = planes[i % 2].data();
+					const bool initial = (i == 0);
+					switch (mode)
+					{
+					case ProjectionMode::Max:
+					case ProjectionMode::Min:
+					{
+						value_t* out = (value_t*)buffer;
+						if (initial)
+						{
+							std::copy(plane, plane + plane_size, out);
+						}
+						else if (mode == ProjectionMode::Max)
+						{
+							for (size_t p = 0; p < plane_size; ++p)
+							{
+								out[p] = std::max(out[p], plane[p]);
+							}
+						}
+						else
+						{
+							for (size_t p = 0; p < plane_size; ++p)
+							{
+								out[p] = std::min(out[p], plane[p]);
+							}
+						}
+						break;
+					}
+					case ProjectionMode::Sum:
+					case ProjectionMode::Mean:
+					{
+						sum_t* out = (mode == ProjectionMode::Sum) ? (sum_t*)buffer : sums.data();
+						if (initial)
+						{
+							std::copy(plane, plane + plane_size, out);
+						}
+						else
+						{
+							for (size_t p = 0; p < plane_size; ++p)
+							{
+								out[p] += sum_t(plane[p]);
+							}
+						}
+						break;
+					}
+					}
+
+					if (next_plane.valid())
+					{
+						err = next_plane.get();
+					}
+					else if (load_after)
+					{
+						err = load(first + i + 1, &planes[(i + 1) % 2]);
+					}
+				}
+
+				if (err == Error::NoError && mode == ProjectionMode::Mean)
+				{
+					value_t* out = (value_t*)buffer;
+					const sum_t n = sum_t(count);
+					for (size_t p = 0; p < plane_size; ++p)
+					{
+						if constexpr (std::is_floating_point_v<value_t>)
+						{
+							out[p] = value_t(sums[p] / n);
+						}
+						else if constexpr (std::is_signed_v<value_t>)
+						{
+							out[p] = value_t((sums[p] + (sums[p] < 0 ? -n / 2 : n / 2)) / n);
+						}
+						else
+						{
+							out[p] = value_t((sums[p] + n / 2) / n);
+						}
+					}
+				}
+				return err;
+			}
+
+			Error project_frames(uint16_t sample, ProjectionMode mode, uint32_t first, uint32_t count, void* buffer, size_t buffer_size)
+			{
+				if (count == 0)
+				{
+					index_frames_until(std::numeric_limits<uint32_t>::max());
+					if (first >= file.frame_ifds.size())
+					{
+						return Error::NoMoreImagesInTiff;
+					}
+					count = static_cast<uint32_t>(file.frame_ifds.size()) - first;
+				}
+				else if (static_cast<uint64_t>(first) + count > std::numeric_limits<uint32_t>::max()
+					|| !index_frames_until(first + count - 1))
+				{
+					return Error::NoMoreImagesInTiff;
+				}
+
+				ReaderFrame reference{};
+				uint32_t next_offset = 0;
+				Error err = parse_frame(file.frame_ifds[first], reference, next_offset);
+				if (err == Error::NoError)
+				{
+					err = check_frame(reference);
+				}
+				if (err != Error::NoError)
+				{
+					return err;
+				}
+				advise_pattern(AccessHint::Sequential);
+
+				const uint32_t out_bytes = (mode == ProjectionMode::Sum) ? 8 : decoded_bits(reference) / 8;
+				if (buffer_size < static_cast<uint64_t>(reference.width) * reference.height * out_bytes)
+				{
+					return Error::BufferTooSmall;
+				}
+
+				if (!util::visit_sample_type(decoded_bits(reference), decoded_format(reference), [&](auto type)
+				{
+					err = project_frames_typed<decltype(type)>(reference, sample, mode, first, count, (uint8_t*)buffer);
+				}))
+				{
+					return Error::InvalidBitPerSample;
+				}
+				return err;
+			}
+
+			// read_frames reads the strips and tiles of at least this many bytes of frames (or a max read size) in one go
+			static constexpr uint64_t volume_batch_bytes = 16 * 1024 * 1024;
+			// and of at most this many frames
+			static constexpr uint32_t volume_batch_frames = 256;
+
+			// one sample plane of a frame read by read_frames, decoded from blocks [block_begin, block_end) of its batch
+			struct VolumePlane
+			{
+				size_t frame = 0;
+				ReaderBlockLayout layout{};
+				size_t block_begin = 0;
+				size_t block_end = 0;
+				uint8_t* dst = nullptr;
+			};
+
+			// frames read together, the layouts point into the frames so these are reserved up front and never move
+			struct VolumeBatch
+			{
+				std::vector<ReaderFrame> frames{};
+				std::vector<VolumePlane> planes{};
+				std::vector<ReaderBlock> blocks{};
+				std::vector<uint8_t> raw{};
+			};
+
+			// reads the whole frames from `next` on into `batch`, frame i of the range goes to buffer + i * frame_stride
+			Error read_volume_batch(uint32_t first, uint32_t count, uint32_t& next, uint16_t first_sample, uint16_t sample_count,
+				const OutputLayout& strides, uint8_t* buffer, VolumeBatch& batch)
+			{
+				batch.frames.clear();
+				batch.frames.reserve(volume_batch_frames);
+				batch.planes.clear();
+				batch.blocks.clear();
+
+				const uint64_t budget = std::max<uint64_t>(volume_batch_bytes, max_read_size);
+				uint64_t batch_bytes = 0;
+				while (next < count && batch.frames.size() < volume_batch_frames && (batch.frames.empty() || batch_bytes < budget))
+				{
+					ReaderFrame& frame = batch.frames.emplace_back();
+					Error err = frame_layout(first + next, frame);
+					if (err != Error::NoError)
+					{
+						return err;
+					}
+					load_frame_tables(frame);
+
+					const Rect region{ 0, 0, frame.width, frame.height };
+					for (uint16_t i = 0; i < sample_count; ++i)
+					{
+						VolumePlane plane{};
+						plane.frame = batch.frames.size() - 1;
+						plane.layout = block_layout(frame, uint16_t(first_sample + i));
+						plane.dst = buffer + next * strides.frame_stride + i * strides.sample_stride;
+						const uint32_t block_count = plane.layout.first_block + plane.layout.blocks_across * plane.layout.blocks_down;
+						if (plane.layout.offsets->size() < block_count || plane.layout.byte_counts->size() < block_count)
+						{
+							return Error::StripDataLost;
+						}
+
+						// the samples of a chunky frame come from the same blocks, which are read once
+						if (i > 0 && plane.layout.first_block == batch.planes.back().layout.first_block)
+						{
+							plane.block_begin = batch.planes.back().block_begin;
+							plane.block_end = batch.planes.back().block_end;
+						}
+						else
+						{
+							plane.block_begin = batch.blocks.size();
+							uint32_t y = 0;
+							band_blocks(plane.layout, region, y, std::numeric_limits<uint64_t>::max(), batch.blocks);
+							plane.block_end = batch.blocks.size();
+							for (size_t b = plane.block_begin; b < plane.block_end; ++b)
+							{
+								batch_bytes += batch.blocks[b].span;
+							}
+						}
+						batch.planes.emplace_back(plane);
+					}
+					++next;
+				}
+				return read_blocks(batch.blocks, batch.raw);
+			}
+
+			Error read_frames(uint32_t first, uint32_t count, uint16_t first_sample, uint16_t sample_count, const OutputLayout& output,
+				void* buffer, size_t buffer_size)
+			{
+				if (count == 0)
+				{
+					index_frames_until(std::numeric_limits<uint32_t>::max());
+					if (first >= file.frame_ifds.size())
+					{
+						return Error::NoMoreImagesInTiff;
+					}
+					count = static_cast<uint32_t>(file.frame_ifds.size()) - first;
+				}
+				else if (static_cast<uint64_t>(first) + count > std::numeric_limits<uint32_t>::max()
+					|| !index_frames_until(first + count - 1))
+				{
+					return Error::NoMoreImagesInTiff;
+				}
+
+				// every frame is checked against the first one before anything is read
+				Vec2ul size{};
+				uint32_t bits = 0;
+				SampleFormat format = SampleFormat::Uint;
+				uint32_t samples = 0;
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					ReaderFrame frame{};
+					Error err = frame_layout(first + i, frame);
+					if (err == Error::NoError)
+					{
+						if (expands_palette(frame))
+						{
+							load_color_map(frame);
+						}
+						err = check_frame(frame);
+					}
+					if (err != Error::NoError)
+					{
+						return err;
+					}
+					const Vec2ul frame_size = display_size(frame);
+					if (i == 0)
+					{
+						size = frame_size;
+						bits = decoded_bits(frame);
+						format = decoded_format(frame);
+						samples = decoded_samples(frame);
+					}
+					else if (frame_size.x != size.x || frame_size.y != size.y || decoded_bits(frame) != bits
+						|| decoded_format(frame) != format || decoded_samples(frame) != samples)
+					{
+						return Error::InconsistentFrames;
+					}
+				}
+				if (sample_count == 0 || static_cast<uint32_t>(first_sample) + sample_count > samples)
+				{
+					return Error::InvalidSampleIndex;
+				}
+
+				const uint32_t bytes_per_sample = bits / 8;
+				const OutputLayout strides = resolve_output(output, uint32_t(size.x), uint32_t(size.y), bytes_per_sample, sample_count);
+				if (strides.column_stride % bytes_per_sample != 0 || strides.row_stride % bytes_per_sample != 0
+					|| strides.sample_stride % bytes_per_sample != 0 || strides.frame_stride % bytes_per_sample != 0)
+				{
+					return Error::InvalidOutputLayout;
+				}
+				const double extent = double(size.x - 1) * strides.column_stride + double(size.y - 1) * strides.row_stride
+					+ double(sample_count - 1) * strides.sample_stride + double(count - 1) * strides.frame_stride + bytes_per_sample;
+				if (double(buffer_size) < extent)
+				{
+					return Error::BufferTooSmall;
+				}
+				advise_pattern(AccessHint::Sequential);
+
+				const uint32_t threads = (decode_threads != 0) ? decode_threads : std::max(1u, std::thread::hardware_concurrency());
+				const Rect target{ 0, 0, uint32_t(size.x), uint32_t(size.y) };
+
+				// the decoders only read the batch they are given, all reads of the file stay on this thread
+				auto decode = [this, &target, &strides, threads](const VolumeBatch* batch, uint32_t part)
+				{
+					std::vector<uint8_t> band{};
+					auto sink = [](uint32_t, const uint8_t*) {};
+					for (size_t p = part; p < batch->planes.size(); p += threads)
+					{
+						const VolumePlane& plane = batch->planes[p];
+						const ReaderFrame& frame = batch->frames[plane.frame];
+						const ReaderOrientation orientation = frame_orientation(frame);
+						const Rect region = stored_rect(orientation, frame.width, frame.height, target);
+						decode_band(frame, plane.layout, orientation, target, region, strides,
+							batch->blocks.data() + plane.block_begin, batch->blocks.data() + plane.block_end,
+							0, frame.height, plane.dst, band, nullptr, sink);
+					}
+				};
+
+				VolumeBatch batches[2]{};
+				uint32_t next = 0;
+				Error result = Error::NoError;
+				Error err = read_volume_batch(first, count, next, first_sample, sample_count, strides, (uint8_t*)buffer, batches[0]);
+				for (uint32_t k = 0; ; ++k)
+				{
+					if (err == Error::StripDataLost)
+					{
+						result = err;
+					}
+					else if (err != Error::NoError)
+					{
+						return err;
+					}
+					const VolumeBatch& batch = batches[k % 2];
+					if (batch.planes.empty())
+					{
+						break;
+					}
+
+					std::vector<std::future<void>> decoders{};
+					uint32_t launched = 0;
+					for (; launched < threads && launched < batch.planes.size(); ++launched)
+					{
+						try
+						{
+							decoders.emplace_back(std::async(std::launch::async, decode, &batch, launched));
+						}
+						catch (const std::system_error&)
+						{
+							break;
+						}
+					}
+					VolumeBatch& following = batches[(k + 1) % 2];
+					err = read_volume_batch(first, count, next, first_sample, sample_count, strides, (uint8_t*)buffer, following);
+					// the parts no thread could be started for are decoded here
+					for (uint32_t part = launched; part < threads && part < batch.planes.size(); ++part)
+					{
+						decode(&batch, part);
+					}
+					for (auto& decoder : decoders)
+					{
+						decoder.get();
+					}
+					for (const auto& frame : batch.frames)
+					{
+						advise_frame(frame, AccessHint::DontNeed);
+					}
+				}
+				return result;
+			}
+
+			template<typename value_t>
+			void read_table(const ReaderTable& table, std::vector<value_t>& values)
+			{
+				const uint64_t value_size = (table.type == DataType::Short) ? 2 : 4;
+				values.clear();
+				if (table.count == 0 || table.data_offset + value_size * table.count > file.size)
+				{
+					return;
+				}
+				values.reserve(table.count);
+				seek(table.data_offset);
+				for (uint32_t i = 0; i < table.count; ++i)
+				{
+					values.emplace_back(static_cast<value_t>((table.type == DataType::Short) ? read<uint16_t>() : read<uint32_t>()));
+				}
+			}
+
+			// reads the strip or tile tables of a frame parsed without them
+			void load_frame_tables(ReaderFrame& frame)
+			{
+				if (frame.tables_loaded)
+				{
+					return;
+				}
+				read_table(frame.offsets_table, frame.is_tiled ? frame.tile_offsets : frame.strip_offsets);
+				read_table(frame.byte_counts_table, frame.is_tiled ? frame.tile_byte_counts : frame.strip_byte_counts);
+				load_color_map(frame);
+				frame.tables_loaded = true;
+			}
+
+			// the color map of a palette frame parsed without its tables
+			void load_color_map(ReaderFrame& frame)
+			{
+				if (frame.color_map.empty() && frame.photometric_interpertation == PhotometricInterpretation::Palette)
+				{
+					read_table(frame.color_map_table, frame.color_map);
+				}
+			}
+
+			// one entry of a strip or tile table which was left in the file
+			uint32_t read_table_value(const ReaderTable& table, uint32_t index)
+			{
+				const uint64_t value_size = (table.type == DataType::Short) ? 2 : 4;
+				seek(table.data_offset + value_size * index);
+				return (table.type == DataType::Short) ? read<uint16_t>() : read<uint32_t>();
+			}
+
+			// profile requests closer than this are served by one read
+			static constexpr uint32_t profile_gap_bytes = 4096;
+			// frames whose requests are sorted and merged together
+			static constexpr uint32_t profile_batch_frames = 1024;
+
+			Error read_profile(uint16_t sample, const std::vector<Vec2ul>& points, uint32_t first, uint32_t count, void* buffer, size_t buffer_size)
+			{
+				if (points.empty())
+				{
+					return Error::InvalidRegion;
+				}
+				if (count == 0)
+				{
+					index_frames_until(std::numeric_limits<uint32_t>::max());
+					if (first >= file.frame_ifds.size())
+					{
+						return Error::NoMoreImagesInTiff;
+					}
+					count = static_cast<uint32_t>(file.frame_ifds.size()) - first;
+				}
+				else if (static_cast<uint64_t>(first) + count > std::numeric_limits<uint32_t>::max()
+					|| !index_frames_until(first + count - 1))
+				{
+					return Error::NoMoreImagesInTiff;
+				}
+
+				// a few bytes here and there, reading ahead would fetch whole strips around them
+				advise_pattern(AccessHint::Random);
+
+				struct Request
+				{
+					uint64_t offset = 0;
+					size_t output = 0;
+					uint32_t bit = 0;
+					uint32_t bytes = 0;
+					uint32_t unit_x = 0;
+					uint32_t unit_y = 0;
+				};
+				std::vector<Request> requests{};
+				std::vector<ReaderBlock> blocks{};
+				std::vector<uint8_t> raw{};
+				std::vector<uint16_t> color_map{};
+
+				ReaderBlockLayout sample_layout{};
+				SampleFormat sample_format = SampleFormat::Uint;
+				Error err = Error::NoError;
+				uint32_t i = 0;
+				while (i < count)
+				{
+					requests.clear();
+					const uint32_t batch_end = std::min(count, i + profile_batch_frames);
+					for (; i < batch_end; ++i)
+					{
+						ReaderFrame frame{};
+						Error frame_err = frame_layout(first + i, frame);
+						if (frame_err == Error::NoError)
+						{
+							if (expands_palette(frame))
 							{
-								for (uint32_t i = 0; i < d.count; ++i)
-								{
-									d.pvalue.emplace_back(read<uint8_t>());
-								}
+								load_color_map(frame);
+							}
+							frame_err = check_frame(frame);
+						}
+						if (frame_err != Error::NoError)
+						{
+							return frame_err;
+						}
+						if (sample >= decoded_samples(frame))
+						{
+							return Error::InvalidSampleIndex;
+						}
+						const ReaderBlockLayout layout = block_layout(frame, sample);
+						if (i == 0)
+						{
+							sample_layout = layout;
+							sample_format = frame.sample_format;
+							// the frame goes away, its color map is kept for all of them
+							color_map = std::move(frame.color_map);
+							if (sample_layout.palette != nullptr)
+							{
+								sample_layout.palette = color_map.data() + (static_cast<size_t>(sample) << layout.bits);
+							}
+							if (buffer_size < static_cast<uint64_t>(count) * points.size() * layout.bytes_per_sample)
+							{
+								return Error::BufferTooSmall;
 							}
 						}
+						// all frames are decoded with the first one's layout into samples of its size
+						else if (layout.bits != sample_layout.bits || layout.fill_reversed != sample_layout.fill_reversed
+							|| layout.bytes_per_sample != sample_layout.bytes_per_sample || layout.half_to_float != sample_layout.half_to_float
+							|| layout.convert != sample_layout.convert || frame.sample_format != sample_format
+							|| (layout.packed && layout.is_signed != sample_layout.is_signed) || frame.color_map != color_map
+							|| layout.color != sample_layout.color || layout.color_ink != sample_layout.color_ink || layout.pixel_bits != sample_layout.pixel_bits
+							|| layout.unit_width != sample_layout.unit_width || layout.unit_height != sample_layout.unit_height)
+						{
+							return Error::InconsistentFrames;
+						}
+
+						if (frame.offsets_table.count < layout.first_block + layout.blocks_across * layout.blocks_down)
+						{
+							return Error::StripDataLost;
+						}
+						// the points are where the pixels are displayed
+						const ReaderOrientation orientation = frame_orientation(frame);
+						const Vec2ul size = display_size(frame);
+						for (size_t p = 0; p < points.size(); ++p)
+						{
+							const auto& point = points[p];
+							if (point.x >= size.x || point.y >= size.y)
+							{
+								return Error::InvalidRegion;
+							}
+							const Rect stored = stored_rect(orientation, frame.width, frame.height,
+								Rect{ static_cast<uint32_t>(point.x), static_cast<uint32_t>(point.y), 1, 1 });
+							const uint32_t x = stored.x;
+							const uint32_t y = stored.y;
+							const uint32_t index = layout.first_block
+								+ (y / layout.block_height) * layout.blocks_across + x / layout.block_width;
+							const uint64_t in_row = static_cast<uint64_t>(x % layout.block_width / layout.unit_width) * layout.pixel_bits + layout.sample_bit_offset;
+							const uint64_t in_block = static_cast<uint64_t>(y % layout.block_height / layout.unit_height) * layout.row_bytes + in_row / 8;
+							// converted colors need every sample of the pixel, or the whole unit when subsampled
+							const uint32_t needed_bits = (layout.color == ColorStage::YCbCr || layout.color == ColorStage::CMYK) ? layout.pixel_bits : layout.bits;
+
+							Request request{};
+							request.offset = read_table_value(frame.offsets_table, index) + in_block;
+							request.output = (static_cast<size_t>(i) * points.size() + p) * sample_layout.bytes_per_sample;
+							request.bit = static_cast<uint32_t>(in_row % 8);
+							request.bytes = (request.bit + needed_bits + 7) / 8;
+							request.unit_x = x % layout.block_width % layout.unit_width;
+							request.unit_y = y % layout.block_height % layout.unit_height;
+							requests.emplace_back(request);
+						}
 					}
-					break;
-				}
-				case DataType::Short:
-				{
-					if (d.count <= 2)
+
+					// neighbouring requests, within a frame or across frames of a contiguous stack, become one read
+					std::sort(requests.begin(), requests.end(), [](const Request& a, const Request& b)
 					{
-						for (int i = 0; i < 2; ++i)
+						return a.offset < b.offset;
+					});
+					blocks.clear();
+					for (const auto& request : requests)
+					{
+						if (!blocks.empty() && request.offset <= blocks.back().offset + blocks.back().span + profile_gap_bytes)
 						{
-							uint32_t v = read<uint16_t>();
-							if (i < d.count) d.pvalue.emplace_back(v);
+							ReaderBlock& block = blocks.back();
+							const uint64_t end = std::max<uint64_t>(block.offset + block.span, request.offset + request.bytes);
+							block.span = static_cast<uint32_t>(end - block.offset);
+							block.size = block.span;
+						}
+						else
+						{
+							ReaderBlock block{};
+							block.offset = request.offset;
+							block.span = request.bytes;
+							block.size = request.bytes;
+							blocks.emplace_back(block);
 						}
 					}
-					else
+
+					if (read_blocks(blocks, raw) != Error::NoError)
 					{
-						pos_changed = true;
-						uint32_t offset = read<uint32_t>();
-						if (offset + static_cast<uint64_t>(d.count) * 2 <= file.size)
+						err = Error::StripDataLost;
+					}
+
+					size_t b = 0;
+					for (const auto& request : requests)
+					{
+						while (request.offset >= blocks[b].offset + blocks[b].span)
 						{
-							file.stream.clear();
-							file.stream.seekg(offset, std::ios_base::beg);
-							for (uint32_t i = 0; i < d.count; ++i)
-							{
-								d.pvalue.emplace_back(read<uint16_t>());
-							}
+							++b;
 						}
+						const uint64_t in_block = request.offset - blocks[b].offset;
+						decode_samples(blocks[b].data + in_block, blocks[b].span - in_block, request.bit,
+							(uint8_t*)buffer + request.output, 1, sample_layout, request.unit_x, request.unit_y);
 					}
-					break;
 				}
-				case DataType::Long:
+				return err;
+			}
+
+			std::vector<variant_t> get_sample_data_internal(uint16_t sample, Error& err, SampleStatistics* statistics = nullptr)
+			{
+				std::vector<variant_t> result{};
+
+				load_frame_tables(file.current_frame);
+				const ReaderFrame& frame = file.current_frame;
+				std::vector<uint8_t> buffer{};
+				buffer.resize(static_cast<size_t>(frame.width) * frame.height * (decoded_bits(frame) / 8));
+
+				const Vec2ul size = display_size(frame);
+				err = decode_region(frame, sample, Rect{ 0, 0, uint32_t(size.x), uint32_t(size.y) }, buffer.data(), OutputLayout{}, statistics, [](uint32_t, const uint8_t*) {});
+				if (err != Error::NoError && err != Error::StripDataLost)
 				{
-					if (d.count <= 1)
+					return result;
+				}
+
+				result.reserve(static_cast<size_t>(frame.width) * frame.height);
+				for (uint32_t i = 0; i < frame.width * frame.height; ++i)
+				{
+					variant_t t{};
+
+					const uint32_t bps = decoded_bits(frame);
+					if (bps == 8)
 					{
-						d.pvalue.emplace_back(read<uint32_t>());
+						t = ((uint8_t*)buffer.data())[i];
 					}
-					else
+					else if (bps == 16)
 					{
-						pos_changed = true;
-						uint32_t offset = read<uint32_t>();
-						if (offset + static_cast<uint64_t>(d.count) * 4 <= file.size)
-						{
-							file.stream.clear();
-							file.stream.seekg(offset, std::ios_base::beg);
-							for (uint32_t i = 0; i < d.count; ++i)
-							{
-								d.pvalue.emplace_back(read<uint32_t>());
-							}
-						}
+						t = ((uint16_t*)buffer.data())[i];
 					}
-					break;
+					else if (bps == 32)
+					{
+						t = ((uint32_t*)buffer.data())[i];
+					}
+					else if (bps == 64)
+					{
+						t = ((uint64_t*)buffer.data())[i];
+					}
+
+					result.emplace_back(t);
 				}
-				case DataType::Rational:
+
+				return result;
+			}
+
+			// the sidecar index only describes the file it was saved for, it is checked against the file size,
+			// modification time and a hash of the first bytes (header and usually the first IFD)
+			static constexpr uint32_t index_version = 4;
+			static constexpr uint64_t index_hashed_bytes = 4096;
+
+			// entries are written field by field, a memcpy of the struct would also write its padding
+			template<typename entry_t, typename visit_t>
+			static void visit_index_fields(entry_t& entry, visit_t&& visit)
+			{
+				visit(entry.ifd_offset);
+				visit(entry.width);
+				visit(entry.height);
+				visit(entry.bits_per_sample);
+				visit(entry.samples_per_pixel);
+				visit(entry.sample_format);
+				visit(entry.planar_config);
+				visit(entry.compression);
+				visit(entry.photometric);
+				visit(entry.orientation);
+				visit(entry.fill_order);
+				visit(entry.is_tiled);
+				visit(entry.rows_per_strip);
+				visit(entry.tile_width);
+				visit(entry.tile_length);
+				for (auto* table : { &entry.offsets_table, &entry.byte_counts_table, &entry.color_map_table })
 				{
-					pos_changed = true;
-					uint32_t offset = read<uint32_t>();
-					if (offset + static_cast<uint64_t>(d.count) * 4 <= file.size)
+					visit(table->type);
+					visit(table->count);
+					visit(table->data_offset);
+				}
+				visit(entry.ycbcr_subsampling);
+			}
+
+			static size_t index_entry_bytes()
+			{
+				ReaderIndexEntry entry{};
+				size_t bytes = 0;
+				visit_index_fields(entry, [&bytes](const auto& value) { bytes += sizeof(value); });
+				return bytes;
+			}
+
+			static ReaderIndexEntry make_index_entry(uint32_t ifd_offset, const ReaderFrame& frame)
+			{
+				ReaderIndexEntry entry{};
+				entry.ifd_offset = ifd_offset;
+				entry.width = frame.width;
+				entry.height = frame.height;
+				entry.bits_per_sample = frame.bits_per_sample;
+				entry.samples_per_pixel = frame.samples_per_pixel;
+				entry.sample_format = uint32_t(frame.sample_format);
+				entry.planar_config = uint32_t(frame.planar_config);
+				entry.compression = uint32_t(frame.compression);
+				entry.photometric = uint32_t(frame.photometric_interpertation);
+				entry.orientation = uint32_t(frame.orientation);
+				entry.fill_order = uint32_t(frame.fill_order);
+				entry.is_tiled = frame.is_tiled ? 1 : 0;
+				entry.rows_per_strip = frame.rows_per_strip;
+				entry.tile_width = frame.tile_width;
+				entry.tile_length = frame.tile_length;
+				entry.offsets_table = frame.offsets_table;
+				entry.byte_counts_table = frame.byte_counts_table;
+				entry.color_map_table = frame.color_map_table;
+				entry.ycbcr_subsampling = frame.ycbcr_subsampling_h | (frame.ycbcr_subsampling_v << 16);
+				return entry;
+			}
+
+			static void apply_index_entry(const ReaderIndexEntry& entry, ReaderFrame& frame)
+			{
+				frame = ReaderFrame{};
+				frame.width = entry.width;
+				frame.height = entry.height;
+				frame.image_length = entry.height;
+				frame.bits_per_sample = entry.bits_per_sample;
+				frame.samples_per_pixel = static_cast<uint16_t>(entry.samples_per_pixel);
+				frame.sample_format = SampleFormat(entry.sample_format);
+				frame.planar_config = PlanarConfiguration(entry.planar_config);
+				frame.compression = CompressionType(entry.compression);
+				frame.photometric_interpertation = PhotometricInterpretation(entry.photometric);
+				frame.orientation = Orientation(entry.orientation);
+				frame.fill_order = FillOrder(entry.fill_order);
+				frame.is_tiled = entry.is_tiled != 0;
+				frame.rows_per_strip = entry.rows_per_strip;
+				frame.strip_count = entry.offsets_table.count;
+				frame.tile_width = entry.tile_width;
+				frame.tile_length = entry.tile_length;
+				frame.offsets_table = entry.offsets_table;
+				frame.byte_counts_table = entry.byte_counts_table;
+				frame.color_map_table = entry.color_map_table;
+				frame.ycbcr_subsampling_h = entry.ycbcr_subsampling & 0xFFFF;
+				frame.ycbcr_subsampling_v = entry.ycbcr_subsampling >> 16;
+			}
+
+			// geometry and table locations of frame `index` (tables stay in the file, see read_table_value),
+			// taken from the sidecar index when it was loaded
+			Error frame_layout(uint32_t index, ReaderFrame& frame)
+			{
+				if (index < file.frame_entries.size())
+				{
+					apply_index_entry(file.frame_entries[index], frame);
+					return Error::NoError;
+				}
+				uint32_t next_offset = 0;
+				return parse_frame(file.frame_ifds[index], frame, next_offset, false);
+			}
+
+			uint64_t header_hash()
+			{
+				std::vector<uint8_t> bytes(static_cast<size_t>(std::min(index_hashed_bytes, file.size)));
+				bytes.resize(static_cast<size_t>(file.source->read_at(0, bytes.data(), bytes.size())));
+				// FNV-1a
+				uint64_t hash = 14695981039346656037ull;
+				for (uint8_t byte : bytes)
+				{
+					hash = (hash ^ byte) * 1099511628211ull;
+				}
+				return hash;
+			}
+
+			int64_t modification_time() const
+			{
+				std::error_code ec{};
+				const auto time = tiff_path.empty() ? std::filesystem::file_time_type{} : std::filesystem::last_write_time(tiff_path, ec);
+				return ec ? 0 : static_cast<int64_t>(time.time_since_epoch().count());
+			}
+
+			// everything but the entries, which follow it
+			std::vector<uint8_t> index_header(uint32_t frame_count)
+			{
+				std::vector<uint8_t> data{ 'T', 'C', 'X', 'I' };
+				auto put = [&data](auto value)
+				{
+					const size_t at = data.size();
+					data.resize(at + sizeof(value));
+					std::memcpy(data.data() + at, &value, sizeof(value));
+				};
+				put(index_version);
+				put(uint16_t(util::get_byte_order()));
+				put(uint32_t(index_entry_bytes()));
+				put(file.size);
+				put(modification_time());
+				put(header_hash());
+				put(file.frame_ifds_next);
+				put(file.frame_ifds_next_field);
+				put(frame_count);
+				return data;
+			}
+
+			Error save_index()
+			{
+				if (index_path.empty())
+				{
+					return Error::WriteFileFailed;
+				}
+
+				index_frames_until(std::numeric_limits<uint32_t>::max());
+				for (uint32_t i = static_cast<uint32_t>(file.frame_entries.size()); i < file.frame_ifds.size(); ++i)
+				{
+					ReaderFrame frame{};
+					Error err = frame_layout(i, frame);
+					if (err != Error::NoError)
 					{
-						file.stream.clear();
-						file.stream.seekg(offset, std::ios_base::beg);
-						for (uint32_t i = 0; i < d.count; ++i)
-						{
-							d.pvalue.emplace_back(read<uint32_t>());
-							d.pvalue2.emplace_back(read<uint32_t>());
-						}
+						return err;
 					}
+					file.frame_entries.emplace_back(make_index_entry(file.frame_ifds[i], frame));
+				}
 
-					break;
+				std::vector<uint8_t> data = index_header(static_cast<uint32_t>(file.frame_entries.size()));
+				data.reserve(data.size() + file.frame_entries.size() * index_entry_bytes());
+				for (const auto& entry : file.frame_entries)
+				{
+					visit_index_fields(entry, [&data](const auto& value)
+					{
+						const size_t at = data.size();
+						data.resize(at + sizeof(value));
+						std::memcpy(data.data() + at, &value, sizeof(value));
+					});
 				}
-				default:
+
+				std::ofstream stream{ index_path, std::ios_base::binary | std::ios_base::trunc };
+				stream.write((const char*)data.data(), static_cast<std::streamsize>(data.size()));
+				stream.close();
+				return stream.fail() ? Error::WriteFileFailed : Error::NoError;
+			}
+
+			// takes the frame index from the sidecar when it matches the file, false leaves the chain to be walked
+			bool load_index()
+			{
+				std::ifstream stream{ index_path, std::ios_base::binary };
+				if (!stream.good())
 				{
-					d.value = read<uint32_t>();
-					break;
+					return false;
+				}
+				std::vector<uint8_t> data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+				uint32_t frame_count = 0;
+				std::vector<uint8_t> header = index_header(0);
+				const size_t count_at = header.size() - sizeof(frame_count);
+				if (data.size() < header.size()
+					|| std::memcmp(data.data(), header.data(), count_at - sizeof(uint32_t) - sizeof(uint64_t)) != 0)
+				{
+					return false;
+				}
+				std::memcpy(&frame_count, data.data() + count_at, sizeof(frame_count));
+				if (data.size() != header.size() + static_cast<size_t>(frame_count) * index_entry_bytes())
+				{
+					return false;
+				}
+
+				std::memcpy(&file.frame_ifds_next, data.data() + count_at - sizeof(uint32_t) - sizeof(uint64_t), sizeof(uint32_t));
+				std::memcpy(&file.frame_ifds_next_field, data.data() + count_at - sizeof(uint64_t), sizeof(uint64_t));
+				file.frame_entries.resize(frame_count);
+				const uint8_t* at = data.data() + header.size();
+				for (auto& entry : file.frame_entries)
+				{
+					visit_index_fields(entry, [&at](auto& value)
+					{
+						std::memcpy(&value, at, sizeof(value));
+						at += sizeof(value);
+					});
+				}
+				file.frame_ifds.clear();
+				for (const auto& entry : file.frame_entries)
+				{
+					file.frame_ifds.emplace_back(entry.ifd_offset);
+				}
+				return true;
+			}
+
+			Error open()
+			{
+				Error err = open_source();
+				if (err == Error::NoError)
+				{
+					err = read_header();
+				}
+				if (err != Error::NoError)
+				{
+					return err;
+				}
+
+				if (!index_path.empty())
+				{
+					load_index();
+				}
+				return read_next_frame();
+			}
+
+			// first frame and frame count of a file, see scan_metadata
+			void scan(FileMetadata& metadata, bool count_frames)
+			{
+				metadata.error = open_source();
+				if (metadata.error == Error::NoError)
+				{
+					metadata.file_size = file.size;
+					metadata.error = read_header();
+				}
+				if (metadata.error != Error::NoError)
+				{
+					return;
+				}
+
+				// the tables are not needed, so they are not read either
+				ReaderFrame frame{};
+				uint32_t next_offset = 0;
+				metadata.error = parse_frame(file.first_record_offset, frame, next_offset, false);
+				if (metadata.error != Error::NoError)
+				{
+					return;
+				}
+				metadata.width = frame.width;
+				metadata.height = frame.height;
+				metadata.bits_per_sample = static_cast<uint16_t>(frame.bits_per_sample);
+				metadata.samples_per_pixel = frame.samples_per_pixel;
+				metadata.sample_format = frame.sample_format;
+				metadata.description = frame.description;
+				if (count_frames)
+				{
+					index_frames_until(std::numeric_limits<uint32_t>::max());
+					metadata.frame_count = static_cast<uint32_t>(file.frame_ifds.size());
+				}
+			}
+
+			Error read_header()
+			{
+				file.system_byte_order = util::get_byte_order();
+				seek(0);
+
+				std::vector<uint8_t> tiffid{ 0, 0, 0 };
+				read_bytes(tiffid.data(), 2);
+				if (tiffid[0] == 'I' && tiffid[1] == 'I')
+				{
+					file.file_byte_order = ByteOrder::LittleEndian;
+				}
+				else if (tiffid[0] == 'M' && tiffid[1] == 'M')
+				{
+					file.file_byte_order = ByteOrder::BigEndian;
+				}
+				else
+				{
+					return Error::InvalidTiffByteOrder;
+				}
+
+				uint16_t magic = read<uint16_t>();
+				if (magic != 42)
+				{
+					return Error::InvalidTiffMagicNumber;
+				}
+
+				file.first_record_offset = read<uint32_t>();
+				file.next_ifd_offset = file.first_record_offset;
+				file.frame_ifds.clear();
+				file.frame_entries.clear();
+				file.frame_ifds_next = file.first_record_offset;
+				file.frame_ifds_next_field = 0;
+				return Error::NoError;
+			}
+		};
+	}
+
+	namespace writer
+	{
+		// IFD entry with its value already laid out in file byte order
+		struct WriterEntry
+		{
+			Tags tag = Tags::ImageWidth;
+			DataType type = DataType::Byte;
+			uint32_t count = 0;
+			std::vector<uint8_t> data{};
+		};
+
+		// one resolution level of the frame being written, rows are collected into a strip or a row of tiles
+		struct WriterLevel
+		{
+			uint32_t width = 0;
+			uint32_t height = 0;
+			uint32_t rows_written = 0;
+
+			uint32_t band_capacity = 0;
+			uint32_t band_rows = 0;
+			uint32_t band_row_bytes = 0;
+			std::vector<uint8_t> band{};
+
+			std::vector<uint8_t> pending_row{};
+			bool has_pending_row = false;
+			std::vector<uint8_t> reduced_row{};
+
+			std::vector<uint32_t> offsets{};
+			std::vector<uint32_t> byte_counts{};
+		};
+
+		struct WriterPrivate
+		{
+			std::filesystem::path tiff_path{};
+			std::ofstream stream{};
+			bool good = false;
+
+			bool in_frame = false;
+			uint32_t frames_written = 0;
+			FrameInfo info{};
+			uint32_t bytes_per_pixel = 0;
+			std::vector<WriterLevel> levels{};
+
+			// position of the offset field which gets the next IFD offset
+			uint64_t next_ifd_field = 0;
+
+			template<typename value_t>
+			void write(value_t v)
+			{
+				stream.write((const char*)(&v), sizeof(v));
+			}
+
+			bool is_tiled() const noexcept
+			{
+				return info.tile_width > 0 && info.tile_length > 0;
+			}
+
+			Error write_block(const uint8_t* data, uint32_t size, WriterLevel& level)
+			{
+				uint64_t offset = static_cast<uint64_t>(stream.tellp());
+				if (offset + size > std::numeric_limits<uint32_t>::max())
+				{
+					return Error::FileSizeLimitExceeded;
+				}
+				stream.write((const char*)data, size);
+				if (!stream.good())
+				{
+					return Error::WriteFileFailed;
 				}
+				level.offsets.emplace_back(static_cast<uint32_t>(offset));
+				level.byte_counts.emplace_back(size);
+				return Error::NoError;
+			}
+
+			Error flush_band(WriterLevel& level)
+			{
+				if (level.band_rows == 0)
+				{
+					return Error::NoError;
 				}
 
-				if (!d.pvalue.empty()) d.value = d.pvalue[0];
-				if (!d.pvalue2.empty()) d.value2 = d.pvalue2[0];
+				Error err = Error::NoError;
+				if (is_tiled())
+				{
+					// the last row of tiles is padded with zeros
+					std::fill(level.band.begin() + static_cast<size_t>(level.band_rows) * level.band_row_bytes, level.band.end(), uint8_t(0));
 
-				if (pos_changed)
+					const uint32_t tile_row_bytes = info.tile_width * bytes_per_pixel;
+					const uint32_t tiles_across = level.band_row_bytes / tile_row_bytes;
+					std::vector<uint8_t> tile(static_cast<size_t>(tile_row_bytes) * info.tile_length);
+					for (uint32_t t = 0; t < tiles_across && err == Error::NoError; ++t)
+					{
+						for (uint32_t y = 0; y < info.tile_length; ++y)
+						{
+							tiff_memcpy_s(&tile[static_cast<size_t>(y) * tile_row_bytes], tile.size() - static_cast<size_t>(y) * tile_row_bytes,
+								&level.band[static_cast<size_t>(y) * level.band_row_bytes + static_cast<size_t>(t) * tile_row_bytes], tile_row_bytes);
+						}
+						err = write_block(tile.data(), static_cast<uint32_t>(tile.size()), level);
+					}
+				}
+				else
 				{
-					file.stream.clear();
-					file.stream.seekg(pos);
-					file.stream.seekg(4, std::ios_base::cur);
+					err = write_block(level.band.data(), level.band_rows * level.band_row_bytes, level);
 				}
 
-				return d;
+				level.band_rows = 0;
+				return err;
 			}
 
-			Error read_next_frame()
+			// averages (or picks from) two rows of `level` into one row of the next level
+			void reduce_rows(const WriterLevel& level, const uint8_t* row0, const uint8_t* row1, uint8_t* out)
 			{
-				Error err = Error::NoError;
-				file.current_frame = ReaderFrame{};
-
-				if (file.next_ifd_offset != 0 && static_cast<uint64_t>(file.next_ifd_offset) + 2 < file.size)
+				const uint32_t spp = info.samples_per_pixel;
+				const uint32_t out_width = (level.width + 1) / 2;
+				const Downsampling mode = info.downsampling;
+				util::visit_sample_type(info.bits_per_sample, info.sample_format, [&](auto type)
 				{
-					file.stream.clear();
-					file.stream.seekg(file.next_ifd_offset, std::ios_base::beg);
-					uint16_t ifd_count = read<uint16_t>();
-					for (uint16_t i = 0; i < ifd_count; ++i)
+					typedef decltype(type) value_t;
+					const value_t* a = (const value_t*)row0;
+					const value_t* b = (const value_t*)row1;
+					value_t* o = (value_t*)out;
+					for (uint32_t x = 0; x < out_width; ++x)
 					{
-						IFD ifd = read_ifd();
-						switch (ifd.tag)
-						{
-						case Tags::ImageWidth:
-						{
-							file.current_frame.width = ifd.value;
-							break;
-						}
-						case Tags::ImageLength:
-						{
-							file.current_frame.image_length = ifd.value;
-							break;
-						}
-						case Tags::BitsPerSample:
-						{
-							file.current_frame.bits_per_sample = ifd.value;
-							if (ifd.count > 0 && !ifd.pvalue.empty())
-							{
-								file.current_frame.bits_per_sample = ifd.pvalue[0];
-								bool ok = true;
-								for (size_t j = 1; j < ifd.pvalue.size(); ++j)
-								{
-									if (ifd.pvalue.at(j) != ifd.pvalue[0])
-									{
-										ok = false; break;
-									}
-								}
-								if (!ok)
-								{
-									err = Error::MultiSampleSizeNotSupport;
-								}
-							}
-							break;
-						}
-						case Tags::Compression:
-						{
-							file.current_frame.compression = CompressionType(ifd.value);
-							break;
-						}
-						case Tags::StripOffsets:
-						{
-							if (ifd.count > 0 && !ifd.pvalue.empty())
-							{
-								file.current_frame.strip_count = ifd.count;
-								for (const auto& v : ifd.pvalue)
-								{
-									file.current_frame.strip_offsets.emplace_back(v);
-								}
-							}
-							break;
-						}
-						case Tags::SamplesPerPixel:
-						{
-							file.current_frame.samples_per_pixel = ifd.value;
-							break;
-						}
-						case Tags::RowsPerStrip:
-						{
-							file.current_frame.rows_per_strip = ifd.value;
-							break;
-						}
-						case Tags::SampleFormat:
-						{
-							file.current_frame.sample_format = SampleFormat(ifd.value);
-							break;
-						}
-						case Tags::ImageDescription:
-						{
-							if (ifd.count > 0 && !ifd.pvalue.empty())
-							{
-								file.current_frame.description = "";
-								for (size_t j = 0; j < ifd.pvalue.size(); ++j)
-								{
-									file.current_frame.description += (char)ifd.pvalue[j];
-								}
-							}
-							break;
-						}
-						case Tags::StripByteCounts:
-						{
-							if (ifd.count > 0 && !ifd.pvalue.empty())
-							{
-								file.current_frame.strip_count = ifd.count;
-								for (const auto& v : ifd.pvalue)
-								{
-									file.current_frame.strip_byte_counts.emplace_back(v);
-								}
-							}
-							break;
-						}
-						case Tags::PlanarConfig:
-						{
-							file.current_frame.planar_config = PlanarConfiguration(ifd.value);
-							break;
-						}
-						case Tags::Orientation:
-						{
-							file.current_frame.orientation = Orientation(ifd.value);
-							break;
-						}
-						case Tags::PhotometricInterpretation:
-						{
-							file.current_frame.photometric_interpertation = PhotometricInterpretation(ifd.value);
-							break;
-						}
-						case Tags::FillOrder:
-						{
-							file.current_frame.fill_order = FillOrder(ifd.value);
-							break;
-						}
-						case Tags::TileByteCounts:
-						case Tags::TileLength:
-						case Tags::TileOffsets:
-						case Tags::TileWidth:
+						const uint32_t x0 = 2 * x * spp;
+						const uint32_t x1 = std::min(2 * x + 1, level.width - 1) * spp;
+						for (uint32_t c = 0; c < spp; ++c)
 						{
-							file.current_frame.is_tiled = true;
-							break;
-						}
-						case Tags::XResolution:
-						{
-							file.current_frame.resolution.x = (float(ifd.value) / float(ifd.value2));
-							break;
-						}
-						case Tags::YResolution:
-						{
-							file.current_frame.resolution.y = (float(ifd.value) / float(ifd.value2));
-							break;
-						}
-						case Tags::ResolutionUnit:
-						{
-							file.current_frame.resolution_unit = ResolutionUnit(ifd.value);
-							break;
-						}
-						default:
-							break;
+							o[x * spp + c] = (mode == Downsampling::Nearest)
+								? a[x0 + c]
+								: util::mean_of_4(a[x0 + c], a[x1 + c], b[x0 + c], b[x1 + c]);
 						}
 					}
-					file.current_frame.height = file.current_frame.image_length;
-					file.stream.clear();
-					typedef std::basic_istream<char, std::char_traits<char>>::off_type off_t;
-					file.stream.seekg(static_cast<off_t>(file.next_ifd_offset) + 2
-						+ 12 * static_cast<off_t>(ifd_count), std::ios_base::beg);
-					file.next_ifd_offset = read<uint32_t>();
+				});
+			}
 
+			Error push_row(size_t index, const uint8_t* row)
+			{
+				WriterLevel& level = levels[index];
+				if (level.rows_written >= level.height)
+				{
+					return Error::InvalidImageSize;
 				}
-				else
+
+				const uint32_t row_bytes = level.width * bytes_per_pixel;
+				tiff_memcpy_s(&level.band[static_cast<size_t>(level.band_rows) * level.band_row_bytes],
+					level.band.size() - static_cast<size_t>(level.band_rows) * level.band_row_bytes, row, row_bytes);
+				level.band_rows += 1;
+				level.rows_written += 1;
+
+				Error err = Error::NoError;
+				if (level.band_rows == level.band_capacity)
 				{
-					err = Error::NoMoreImagesInTiff;
+					err = flush_band(level);
 				}
 
-				good = (err == Error::NoError);
+				// reduce every row pair while it is still in cache, the next level never needs a second pass
+				if (err == Error::NoError && index + 1 < levels.size())
+				{
+					if (!level.has_pending_row)
+					{
+						tiff_memcpy_s(level.pending_row.data(), level.pending_row.size(), row, row_bytes);
+						level.has_pending_row = true;
+					}
+					else
+					{
+						level.has_pending_row = false;
+						reduce_rows(level, level.pending_row.data(), row, level.reduced_row.data());
+						err = push_row(index + 1, level.reduced_row.data());
+					}
+				}
 				return err;
 			}
 
-			std::vector<variant_t> get_sample_data_internal(uint16_t sample, Error& err)
+			Error begin_frame(const FrameInfo& frame_info)
 			{
-				std::vector<variant_t> result{};
-				if (file.current_frame.compression != CompressionType::None)
+				if (in_frame)
 				{
-					err = Error::CompressionNotSupport;
-					return result;
+					return Error::FrameIsNotComplete;
 				}
-				if (file.current_frame.is_tiled)
+				if (frame_info.width == 0 || frame_info.height == 0 || frame_info.samples_per_pixel == 0)
 				{
-					err = Error::TiledNotSupport;
-					return result;
+					return Error::InvalidImageSize;
 				}
-				if (file.current_frame.orientation != Orientation::Stantard)
+				if (!util::visit_sample_type(frame_info.bits_per_sample, frame_info.sample_format, [](auto) {}))
 				{
-					err = Error::OrientationNotSupport;
-					return result;
+					return Error::InvalidBitPerSample;
 				}
-				if (file.current_frame.photometric_interpertation == PhotometricInterpretation::Palette)
+				if ((frame_info.tile_width > 0 || frame_info.tile_length > 0)
+					&& (frame_info.tile_width == 0 || frame_info.tile_length == 0
+						|| frame_info.tile_width % 16 != 0 || frame_info.tile_length % 16 != 0))
 				{
-					err = Error::PhotometricInterpretationNotSupport;
-					return result;
+					return Error::InvalidTileSize;
 				}
-				if (file.current_frame.width == 0 || file.current_frame.height == 0)
+
+				info = frame_info;
+				bytes_per_pixel = info.samples_per_pixel * info.bits_per_sample / 8;
+				if (info.pyramid_storage == PyramidStorage::None)
 				{
-					err = Error::InvalidImageSize;
-					return result;
+					info.pyramid_levels = 0;
 				}
+
+				levels.clear();
+				levels.resize(static_cast<size_t>(info.pyramid_levels) + 1);
+				uint32_t width = info.width;
+				uint32_t height = info.height;
+				for (auto& level : levels)
 				{
-					const uint32_t& bps = file.current_frame.bits_per_sample;
-					if (bps != 8 && bps != 16 && bps != 32 && bps != 64)
+					level.width = width;
+					level.height = height;
+					if (is_tiled())
+					{
+						const uint32_t tiles_across = (width + info.tile_width - 1) / info.tile_width;
+						level.band_capacity = info.tile_length;
+						level.band_row_bytes = tiles_across * info.tile_width * bytes_per_pixel;
+					}
+					else
 					{
-						err = Error::InvalidBitPerSample;
-						return result;
+						const uint32_t row_bytes = width * bytes_per_pixel;
+						level.band_capacity = info.rows_per_strip > 0
+							? info.rows_per_strip
+							: std::max<uint32_t>(1, (256 * 1024) / row_bytes);
+						level.band_capacity = std::min(level.band_capacity, height);
+						level.band_row_bytes = row_bytes;
 					}
+					level.band.resize(static_cast<size_t>(level.band_capacity) * level.band_row_bytes);
+					level.pending_row.resize(static_cast<size_t>(width) * bytes_per_pixel);
+					level.reduced_row.resize(static_cast<size_t>((width + 1) / 2) * bytes_per_pixel);
+
+					width = (width + 1) / 2;
+					height = (height + 1) / 2;
 				}
-				const uint32_t sample_image_size_bytes = file.current_frame.width * file.current_frame.height
-					* file.current_frame.bits_per_sample / 8;
 
-				std::vector<uint8_t> buffer{};
-				buffer.resize(sample_image_size_bytes);
+				in_frame = true;
+				return Error::NoError;
+			}
 
-				std::streampos pos = file.stream.tellg();
-				if (file.current_frame.strip_count > 0 && !file.current_frame.strip_byte_counts.empty() && !file.current_frame.strip_offsets.empty())
+			Error write_rows(const void* data, uint32_t rows)
+			{
+				if (!in_frame)
 				{
-					if (file.current_frame.samples_per_pixel == 1 || file.current_frame.planar_config == PlanarConfiguration::Planar)
+					return Error::FrameIsNotComplete;
+				}
+				const uint8_t* row = (const uint8_t*)data;
+				const size_t row_bytes = static_cast<size_t>(info.width) * bytes_per_pixel;
+				for (uint32_t y = 0; y < rows; ++y, row += row_bytes)
+				{
+					Error err = push_row(0, row);
+					if (err != Error::NoError)
 					{
-						const uint32_t sample_start_bytes = sample * sample_image_size_bytes;
-						const uint32_t sample_end_bytes = sample_start_bytes + sample_image_size_bytes;
+						return err;
+					}
+				}
+				return Error::NoError;
+			}
 
+			template<typename value_t>
+			static void add_entry(std::vector<WriterEntry>& entries, Tags tag, DataType type, const std::vector<value_t>& values)
+			{
+				WriterEntry e{};
+				e.tag = tag;
+				e.type = type;
+				e.count = static_cast<uint32_t>(values.size());
+				e.data.resize(values.size() * sizeof(value_t));
+				if (!values.empty())
+				{
+					tiff_memcpy_s(e.data.data(), e.data.size(), values.data(), e.data.size());
+				}
+				entries.emplace_back(std::move(e));
+			}
 
-						uint32_t strip = 0;
-						uint32_t file_imageidx_bytes = 0;
-						uint32_t output_imageidx_bytes = 0;
-						for (strip = 0; strip < file.current_frame.strip_count; ++strip)
-						{
-							const uint32_t strip_size_bytes = file.current_frame.strip_byte_counts.at(strip);
-							const uint32_t strip_offset_bytes = file.current_frame.strip_offsets.at(strip);
-							auto bytes_to_read_result = util::do_ranges_overlap(
-								Vec2ul{ sample_start_bytes, sample_end_bytes },
-								Vec2ul{ file_imageidx_bytes, file_imageidx_bytes + strip_size_bytes }
-							);
-							if (bytes_to_read_result.has_value())
-							{
-								const auto& bytes_to_read_range = bytes_to_read_result.value();
-								const uint32_t count_bytes_to_read = bytes_to_read_range.y - bytes_to_read_range.x;
+			std::vector<WriterEntry> make_entries(const WriterLevel& level, bool reduced) const
+			{
+				const uint16_t spp = info.samples_per_pixel;
+				const uint16_t color_samples = spp >= 3 ? 3 : 1;
 
-								const auto& seek_offset = strip_offset_bytes + (bytes_to_read_range.x - file_imageidx_bytes);
+				std::vector<WriterEntry> entries{};
+				add_entry(entries, Tags::NewSubfileType, DataType::Long,
+					std::vector<uint32_t>{ uint32_t(reduced ? SubfileType::ReducedResolution : SubfileType::Default) });
+				add_entry(entries, Tags::ImageWidth, DataType::Long, std::vector<uint32_t>{ level.width });
+				add_entry(entries, Tags::ImageLength, DataType::Long, std::vector<uint32_t>{ level.height });
+				add_entry(entries, Tags::BitsPerSample, DataType::Short, std::vector<uint16_t>(spp, info.bits_per_sample));
+				add_entry(entries, Tags::Compression, DataType::Short, std::vector<uint16_t>{ uint16_t(CompressionType::None) });
+				add_entry(entries, Tags::PhotometricInterpretation, DataType::Short, std::vector<uint16_t>{
+					uint16_t(color_samples == 3 ? PhotometricInterpretation::RGB : PhotometricInterpretation::BlackIsZero) });
+				add_entry(entries, Tags::SamplesPerPixel, DataType::Short, std::vector<uint16_t>{ spp });
+				add_entry(entries, Tags::PlanarConfig, DataType::Short, std::vector<uint16_t>{ uint16_t(PlanarConfiguration::Chunky) });
+				add_entry(entries, Tags::SampleFormat, DataType::Short, std::vector<uint16_t>(spp, uint16_t(info.sample_format)));
+				if (spp > color_samples)
+				{
+					std::vector<uint16_t> extra(spp - color_samples, uint16_t(ExtraSamples::Unspecified));
+					if (spp == 2 || spp == 4)
+					{
+						extra[0] = uint16_t(ExtraSamples::UnassociatedAlpha);
+					}
+					add_entry(entries, Tags::ExtraSamples, DataType::Short, extra);
+				}
+				if (!reduced && !info.description.empty())
+				{
+					std::vector<uint8_t> text(info.description.begin(), info.description.end());
+					text.emplace_back(0);
+					add_entry(entries, Tags::ImageDescription, DataType::ASCII, text);
+				}
+				if (is_tiled())
+				{
+					add_entry(entries, Tags::TileWidth, DataType::Long, std::vector<uint32_t>{ info.tile_width });
+					add_entry(entries, Tags::TileLength, DataType::Long, std::vector<uint32_t>{ info.tile_length });
+					add_entry(entries, Tags::TileOffsets, DataType::Long, level.offsets);
+					add_entry(entries, Tags::TileByteCounts, DataType::Long, level.byte_counts);
+				}
+				else
+				{
+					add_entry(entries, Tags::RowsPerStrip, DataType::Long, std::vector<uint32_t>{ level.band_capacity });
+					add_entry(entries, Tags::StripOffsets, DataType::Long, level.offsets);
+					add_entry(entries, Tags::StripByteCounts, DataType::Long, level.byte_counts);
+				}
+				return entries;
+			}
 
-								file.stream.clear();
-								file.stream.seekg(seek_offset, std::ios_base::beg);
+			// writes the IFD and its out of line values at the end of file
+			Error write_ifd(std::vector<WriterEntry>& entries, uint32_t next_ifd_offset, uint32_t& ifd_offset, uint64_t& next_field)
+			{
+				std::sort(entries.begin(), entries.end(), [](const WriterEntry& a, const WriterEntry& b)
+				{
+					return uint16_t(a.tag) < uint16_t(b.tag);
+				});
 
-								file.stream.read((char*)(buffer.data()) + output_imageidx_bytes, count_bytes_to_read);
-								auto read_bytes = file.stream.gcount();
-								if (read_bytes != count_bytes_to_read)
-								{
-									err = Error::StripDataLost;
-								}
-								output_imageidx_bytes += count_bytes_to_read;
-							}
-							else if (file_imageidx_bytes > sample_end_bytes)
-							{
-								break; // have read all data
-							}
+				uint64_t offset = static_cast<uint64_t>(stream.tellp());
+				if (offset % 2 != 0)
+				{
+					write<uint8_t>(0);
+					offset += 1;
+				}
 
-							file_imageidx_bytes += strip_size_bytes;
+				const uint64_t table_bytes = 2 + 12 * static_cast<uint64_t>(entries.size()) + 4;
+				uint64_t data_offset = offset + table_bytes;
+				std::vector<uint8_t> data{};
+				for (const auto& e : entries)
+				{
+					if (e.data.size() > 4)
+					{
+						data.insert(data.end(), e.data.begin(), e.data.end());
+						if (data.size() % 2 != 0)
+						{
+							data.emplace_back(0);
 						}
 					}
 				}
-				else if (file.current_frame.samples_per_pixel > 1 && file.current_frame.planar_config == PlanarConfiguration::Chunky)
+				if (data_offset + data.size() > std::numeric_limits<uint32_t>::max())
+				{
+					return Error::FileSizeLimitExceeded;
+				}
+
+				write<uint16_t>(static_cast<uint16_t>(entries.size()));
+				for (const auto& e : entries)
 				{
-					uint32_t strip = 0;
-					uint32_t file_imageidx_bytes = 0;
-					uint32_t output_imageidx_bytes = 0;
-					std::vector<uint8_t> stripdata{};
-					uint32_t last_stripsize_bytes = 0;
-					for (strip = 0; strip < file.current_frame.strip_count; ++strip)
+					write<uint16_t>(uint16_t(e.tag));
+					write<uint16_t>(uint16_t(e.type));
+					write<uint32_t>(e.count);
+					if (e.data.size() > 4)
 					{
-						const uint32_t stripsize_bytes = file.current_frame.strip_byte_counts[strip];
-						const uint32_t strip_offset_bytes = file.current_frame.strip_offsets[strip];
-						if (stripsize_bytes > last_stripsize_bytes)
-						{
-							stripdata.clear();
-							stripdata.resize(stripsize_bytes);
-							last_stripsize_bytes = stripsize_bytes;
-						}
+						write<uint32_t>(static_cast<uint32_t>(data_offset));
+						data_offset += e.data.size() + e.data.size() % 2;
+					}
+					else
+					{
+						uint8_t value[4]{ 0, 0, 0, 0 };
+						std::copy(e.data.begin(), e.data.end(), value);
+						stream.write((const char*)value, 4);
+					}
+				}
+				write<uint32_t>(next_ifd_offset);
+				stream.write((const char*)data.data(), data.size());
 
-						file.stream.clear();
-						file.stream.seekg(strip_offset_bytes, std::ios::beg);
-						file.stream.read((char*)stripdata.data(), stripsize_bytes);
-						auto readbytes = file.stream.gcount();
-						if (readbytes != stripsize_bytes)
-						{
-							err = Error::StripDataLost;
-						}
+				ifd_offset = static_cast<uint32_t>(offset);
+				next_field = offset + table_bytes - 4;
+				return stream.good() ? Error::NoError : Error::WriteFileFailed;
+			}
 
-						uint32_t strip_i = 0;
-						for (strip_i = sample * file.current_frame.bits_per_sample / 8;
-							strip_i < stripsize_bytes;
-							strip_i += file.current_frame.bits_per_sample / 8 * file.current_frame.samples_per_pixel)
-						{
-							for (int i = 0; i < file.current_frame.bits_per_sample / 8; ++i)
-							{
-								tiff_memcpy_s(&buffer[output_imageidx_bytes], sample_image_size_bytes - output_imageidx_bytes,
-									&stripdata[strip_i], file.current_frame.bits_per_sample / 8);
+			Error patch_offset(uint64_t field, uint32_t value)
+			{
+				std::streampos end = stream.tellp();
+				stream.seekp(static_cast<std::streamoff>(field), std::ios_base::beg);
+				write<uint32_t>(value);
+				stream.seekp(end);
+				return stream.good() ? Error::NoError : Error::WriteFileFailed;
+			}
 
-								output_imageidx_bytes += file.current_frame.bits_per_sample / 8;
-							}
+			Error end_frame()
+			{
+				if (!in_frame)
+				{
+					return Error::FrameIsNotComplete;
+				}
+				if (levels[0].rows_written != levels[0].height)
+				{
+					return Error::FrameIsNotComplete;
+				}
+				in_frame = false;
 
-							file_imageidx_bytes += stripsize_bytes;
-						}
+				Error err = Error::NoError;
+				for (size_t i = 0; i < levels.size() && err == Error::NoError; ++i)
+				{
+					// odd heights pair the last row with itself
+					if (levels[i].has_pending_row)
+					{
+						levels[i].has_pending_row = false;
+						reduce_rows(levels[i], levels[i].pending_row.data(), levels[i].pending_row.data(), levels[i].reduced_row.data());
+						err = push_row(i + 1, levels[i].reduced_row.data());
 					}
-
-					if (file.system_byte_order != file.file_byte_order)
+					if (err == Error::NoError)
 					{
-						const auto& bps = file.current_frame.bits_per_sample;
-						if (bps == 8)
-						{
-							// 1-byte data
-						}
-						else if (bps == 16)
-						{
-							for (uint32_t x = 0; x < file.current_frame.width * file.current_frame.height; ++x)
-							{
-								((uint16_t*)buffer.data())[x] = util::byte_swap(((uint16_t*)buffer.data())[x]);
-							}
-						}
-						else if (bps == 32)
-						{
-							for (uint32_t x = 0; x < file.current_frame.width * file.current_frame.height; ++x)
-							{
-								((uint32_t*)buffer.data())[x] = util::byte_swap(((uint32_t*)buffer.data())[x]);
-							}
-						}
-						else if (bps == 64)
-						{
-							for (uint32_t x = 0; x < file.current_frame.width * file.current_frame.height; ++x)
-							{
-								((uint64_t*)buffer.data())[x] = util::byte_swap(((uint64_t*)buffer.data())[x]);
-							}
-						}
+						err = flush_band(levels[i]);
 					}
 				}
-
-				for (uint32_t i = 0; i < file.current_frame.width * file.current_frame.height; ++i)
+				if (err != Error::NoError)
 				{
-					variant_t t{};
+					return err;
+				}
 
-					const auto& bps = file.current_frame.bits_per_sample;
-					if (bps == 8)
-					{
-						t = ((uint8_t*)buffer.data())[i];
-					}
-					else if (bps == 16)
+				// reduced levels go first so that every IFD knows the offset it points to
+				const bool chained = info.pyramid_storage == PyramidStorage::Chained;
+				std::vector<uint32_t> level_ifds(levels.size(), 0);
+				uint64_t tail_field = 0;
+				for (size_t i = levels.size() - 1; i > 0 && err == Error::NoError; --i)
+				{
+					auto entries = make_entries(levels[i], true);
+					uint32_t next = (chained && i + 1 < levels.size()) ? level_ifds[i + 1] : 0;
+					uint64_t field = 0;
+					err = write_ifd(entries, next, level_ifds[i], field);
+					if (chained && i + 1 == levels.size())
 					{
-						t = ((uint16_t*)buffer.data())[i];
+						tail_field = field;
 					}
-					else if (bps == 32)
+				}
+				if (err != Error::NoError)
+				{
+					return err;
+				}
+
+				auto entries = make_entries(levels[0], false);
+				uint32_t next = 0;
+				if (levels.size() > 1)
+				{
+					if (chained)
 					{
-						t = ((uint32_t*)buffer.data())[i];
+						next = level_ifds[1];
 					}
-					else if (bps == 64)
+					else
 					{
-						t = ((uint64_t*)buffer.data())[i];
+						add_entry(entries, Tags::SubIFDs, DataType::Long, std::vector<uint32_t>(level_ifds.begin() + 1, level_ifds.end()));
 					}
-
-					result.emplace_back(t);
+				}
+				uint64_t field = 0;
+				err = write_ifd(entries, next, level_ifds[0], field);
+				if (err != Error::NoError)
+				{
+					return err;
+				}
+				if (tail_field == 0)
+				{
+					tail_field = field;
 				}
 
-				file.stream.clear();
-				file.stream.seekg(pos);
-
-				err = Error::NoError;
-				return result;
+				// linking the frame commits it, readers following the file see it once this is flushed
+				err = patch_offset(next_ifd_field, level_ifds[0]);
+				next_ifd_field = tail_field;
+				stream.flush();
+				if (err == Error::NoError)
+				{
+					++frames_written;
+				}
+				return err;
 			}
 
 			Error open()
 			{
-				file.system_byte_order = util::get_byte_order();
-
-				file.stream.open(tiff_path, std::ios_base::binary);
-				if (!file.stream.good())
+				stream.open(tiff_path, std::ios_base::binary | std::ios_base::trunc);
+				if (!stream.good())
 				{
 					return Error::OpenFileFailed;
 				}
 
-				file.stream.ignore(std::numeric_limits<std::streamsize>::max());
-				file.size = file.stream.gcount();
-				file.stream.clear(); // reset eof bit
-				file.stream.seekg(0, std::ios_base::beg);
+				const char* order = (util::get_byte_order() == ByteOrder::BigEndian) ? "MM" : "II";
+				stream.write(order, 2);
+				write<uint16_t>(42);
+				next_ifd_field = static_cast<uint64_t>(stream.tellp());
+				write<uint32_t>(0);
 
-				std::vector<uint8_t> tiffid{ 0, 0, 0 };
-				file.stream.read((char*)tiffid.data(), 2);
-				if (tiffid[0] == 'I' && tiffid[1] == 'I')
-				{
-					file.file_byte_order = ByteOrder::LittleEndian;
-				}
-				else if (tiffid[0] == 'M' && tiffid[1] == 'M')
-				{
-					file.file_byte_order = ByteOrder::BigEndian;
-				}
-				else
-				{
-					return Error::InvalidTiffByteOrder;
-				}
+				frames_written = 0;
+				good = stream.good();
+				return good ? Error::NoError : Error::WriteFileFailed;
+			}
 
-				uint16_t magic = read<uint16_t>();
-				if (magic != 42)
+			Error close()
+			{
+				Error err = in_frame ? Error::FrameIsNotComplete : Error::NoError;
+				in_frame = false;
+				if (stream.is_open())
 				{
-					return Error::InvalidTiffMagicNumber;
+					stream.close();
+					if (stream.fail() && err == Error::NoError)
+					{
+						err = Error::WriteFileFailed;
+					}
+					// the first IFD offset is still 0, no reader would take the file
+					if (frames_written == 0)
+					{
+						std::error_code ec{};
+						std::filesystem::remove(tiff_path, ec);
+						err = Error::FrameIsNotComplete;
+					}
 				}
-
-				file.first_record_offset = read<uint32_t>();
-				file.next_ifd_offset = file.first_record_offset;
-
-				return read_next_frame();
+				good = false;
+				return err;
 			}
 		};
 	}
@@ -795,10 +5304,64 @@ tiff::reader::Reader::Reader(std::filesystem::path tiff_path) noexcept
 	_p->tiff_path = tiff_path;
 }
 
+tiff::reader::Reader::Reader(const void* data, size_t size) noexcept
+{
+	_p = std::make_shared<ReaderPrivate>();
+	_p->file.source = std::make_shared<MemorySource>(data, size);
+}
+
+tiff::reader::Reader::Reader(std::shared_ptr<ByteSource> source) noexcept
+{
+	_p = std::make_shared<ReaderPrivate>();
+	_p->file.source = source;
+}
+
 tiff::reader::Reader::~Reader() noexcept
 {
 }
 
+std::vector<tiff::reader::FileMetadata> tiff::reader::scan_metadata(const std::vector<std::filesystem::path>& paths,
+	bool count_frames, uint32_t threads) noexcept
+{
+	std::vector<FileMetadata> result(paths.size());
+	std::atomic<size_t> next{ 0 };
+	auto work = [&]()
+	{
+		for (size_t i = next++; i < paths.size(); i = next++)
+		{
+			ReaderPrivate reader{};
+			reader.tiff_path = paths[i];
+			result[i].path = paths[i];
+			reader.scan(result[i], count_frames);
+		}
+	};
+
+	if (threads == 0)
+	{
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	threads = static_cast<uint32_t>(std::min<size_t>(threads, paths.size()));
+	std::vector<std::thread> pool{};
+	for (uint32_t t = 1; t < threads; ++t)
+	{
+		// the files are shared out as the threads ask for them, so fewer threads (or just this one) scan them all
+		try
+		{
+			pool.emplace_back(work);
+		}
+		catch (const std::system_error&)
+		{
+			break;
+		}
+	}
+	work();
+	for (auto& thread : pool)
+	{
+		thread.join();
+	}
+	return result;
+}
+
 tiff::Error tiff::reader::Reader::open() noexcept
 {
 	return _p->open();
@@ -811,12 +5374,12 @@ bool tiff::reader::Reader::good() const noexcept
 
 uint32_t tiff::reader::Reader::width() const noexcept
 {
-	return _p->file.current_frame.width;
+	return static_cast<uint32_t>(_p->display_size(_p->file.current_frame).x);
 }
 
 uint32_t tiff::reader::Reader::height() const noexcept
 {
-	return _p->file.current_frame.height;
+	return static_cast<uint32_t>(_p->display_size(_p->file.current_frame).y);
 }
 
 std::string tiff::reader::Reader::image_description() const noexcept
@@ -828,23 +5391,14 @@ uint32_t tiff::reader::Reader::count_frames() const noexcept
 {
 	if (_p->good)
 	{
-		uint32_t frames = 0;
-		std::streampos pos = _p->file.stream.tellg();
-
-		uint32_t next_offset = _p->file.first_record_offset;
-		while (next_offset > 0)
+		const uint64_t pos = _p->file.position;
+		if (_p->follow)
 		{
-			_p->file.stream.clear();
-			_p->file.stream.seekg(next_offset, std::ios_base::beg);
-			uint16_t count = _p->read<uint16_t>() * 12;
-			_p->file.stream.seekg(count, std::ios_base::cur);
-			next_offset = _p->read<uint32_t>();
-			frames += 1;
+			_p->refresh();
 		}
-
-		_p->file.stream.clear();
-		_p->file.stream.seekg(pos);
-		return frames;
+		_p->index_frames_until(std::numeric_limits<uint32_t>::max());
+		_p->seek(pos);
+		return static_cast<uint32_t>(_p->file.frame_ifds.size());
 	}
 	return 0;
 }
@@ -857,9 +5411,53 @@ bool tiff::reader::Reader::has_next_frame() const noexcept
 	{
 		return true;
 	}
+	if (_p->good && _p->follow)
+	{
+		return _p->refresh();
+	}
 	return false;
 }
 
+void tiff::reader::Reader::set_index_path(std::filesystem::path index_path) noexcept
+{
+	_p->index_path = index_path;
+}
+
+tiff::Error tiff::reader::Reader::save_index() const noexcept
+{
+	if (!_p->good)
+	{
+		return Error::ReaderIsNotGoodYet;
+	}
+	const uint64_t pos = _p->file.position;
+	Error err = _p->save_index();
+	_p->seek(pos);
+	return err;
+}
+
+void tiff::reader::Reader::set_follow(bool follow) noexcept
+{
+	_p->follow = follow;
+}
+
+bool tiff::reader::Reader::wait_for_next_frame(uint32_t timeout_ms) const noexcept
+{
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+	std::chrono::steady_clock::duration delay = std::chrono::milliseconds(1);
+	while (!has_next_frame())
+	{
+		const auto now = std::chrono::steady_clock::now();
+		if (!_p->good || !_p->follow || now >= deadline)
+		{
+			return false;
+		}
+		// polling backs off from 1 ms to 50 ms while nothing arrives
+		std::this_thread::sleep_for(std::min(delay, deadline - now));
+		delay = std::min<std::chrono::steady_clock::duration>(delay * 2, std::chrono::milliseconds(50));
+	}
+	return true;
+}
+
 tiff::Error tiff::reader::Reader::read_next_frame() const noexcept
 {
 	if (!has_next_frame())
@@ -903,3 +5501,273 @@ std::vector<tiff::variant_t> tiff::reader::Reader::get_sample_data(uint16_t samp
 	err = Error::ReaderIsNotGoodYet;
 	return {};
 }
+
+std::vector<tiff::variant_t> tiff::reader::Reader::get_sample_data(uint16_t sample, tiff::Error& err, SampleStatistics& statistics)
+{
+	if (_p->good)
+	{
+		return _p->get_sample_data_internal(sample, err, &statistics);
+	}
+	err = Error::ReaderIsNotGoodYet;
+	return {};
+}
+
+uint32_t tiff::reader::Reader::count_levels() const noexcept
+{
+	if (_p->good)
+	{
+		return static_cast<uint32_t>(_p->file.current_levels.size()) + 1;
+	}
+	return 0;
+}
+
+tiff::Vec2ul tiff::reader::Reader::level_size(uint32_t level) const noexcept
+{
+	const ReaderFrame* frame = _p->level_frame(level);
+	if (_p->good && frame != nullptr)
+	{
+		return _p->display_size(*frame);
+	}
+	return Vec2ul{};
+}
+
+uint32_t tiff::reader::Reader::select_level(uint32_t min_width, uint32_t min_height) const noexcept
+{
+	// levels are sorted from large to small, so the last one still covering the requested size wins
+	uint32_t level = 0;
+	for (uint32_t i = 1; i < count_levels(); ++i)
+	{
+		const Vec2ul size = _p->display_size(*_p->level_frame(i));
+		if (size.x >= min_width && size.y >= min_height)
+		{
+			level = i;
+		}
+	}
+	return level;
+}
+
+tiff::Error tiff::reader::Reader::read_region(uint32_t level, uint16_t sample, const Rect& region, void* buffer, size_t buffer_size,
+	SampleStatistics* statistics) noexcept
+{
+	if (_p->good)
+	{
+		return _p->read_region(level, sample, region, buffer, buffer_size, statistics);
+	}
+	return Error::ReaderIsNotGoodYet;
+}
+
+tiff::Error tiff::reader::Reader::read_samples(uint32_t level, uint16_t first_sample, uint16_t sample_count, const Rect& region,
+	const OutputLayout& output, void* buffer, size_t buffer_size) noexcept
+{
+	if (_p->good)
+	{
+		return _p->read_samples(level, first_sample, sample_count, region, output, buffer, buffer_size);
+	}
+	return Error::ReaderIsNotGoodYet;
+}
+
+
+tiff::writer::Writer::Writer(std::filesystem::path tiff_path) noexcept
+{
+	_p = std::make_shared<WriterPrivate>();
+	_p->tiff_path = tiff_path;
+}
+
+tiff::writer::Writer::~Writer() noexcept
+{
+	_p->close();
+}
+
+bool tiff::writer::Writer::good() const noexcept
+{
+	return _p->good;
+}
+
+tiff::Error tiff::writer::Writer::open() noexcept
+{
+	return _p->open();
+}
+
+tiff::Error tiff::writer::Writer::close() noexcept
+{
+	return _p->close();
+}
+
+tiff::Error tiff::writer::Writer::begin_frame(const FrameInfo& info) noexcept
+{
+	if (_p->good)
+	{
+		return _p->begin_frame(info);
+	}
+	return Error::WriterIsNotGoodYet;
+}
+
+tiff::Error tiff::writer::Writer::write_rows(const void* data, uint32_t rows) noexcept
+{
+	if (_p->good)
+	{
+		return _p->write_rows(data, rows);
+	}
+	return Error::WriterIsNotGoodYet;
+}
+
+tiff::Error tiff::writer::Writer::end_frame() noexcept
+{
+	if (_p->good)
+	{
+		return _p->end_frame();
+	}
+	return Error::WriterIsNotGoodYet;
+}
+
+tiff::Error tiff::writer::Writer::write_frame(const FrameInfo& info, const void* data) noexcept
+{
+	Error err = begin_frame(info);
+	if (err == Error::NoError)
+	{
+		err = write_rows(data, info.height);
+	}
+	if (err == Error::NoError)
+	{
+		err = end_frame();
+	}
+	return err;
+}
+
+tiff::Error tiff::reader::Reader::read_binned(uint16_t sample, uint32_t factor, BinMode mode, void* buffer, size_t buffer_size) noexcept
+{
+	if (_p->good)
+	{
+		return _p->read_binned(sample, factor, mode, buffer, buffer_size);
+	}
+	return Error::ReaderIsNotGoodYet;
+}
+
+tiff::Error tiff::reader::Reader::project_frames(uint16_t sample, ProjectionMode mode, uint32_t first, uint32_t count, void* buffer, size_t buffer_size) noexcept
+{
+	if (_p->good)
+	{
+		return _p->project_frames(sample, mode, first, count, buffer, buffer_size);
+	}
+	return Error::ReaderIsNotGoodYet;
+}
+
+tiff::Error tiff::reader::Reader::read_profile(uint16_t sample, const std::vector<Vec2ul>& points, uint32_t first, uint32_t count,
+	void* buffer, size_t buffer_size) noexcept
+{
+	if (_p->good)
+	{
+		return _p->read_profile(sample, points, first, count, buffer, buffer_size);
+	}
+	return Error::ReaderIsNotGoodYet;
+}
+
+tiff::Error tiff::reader::Reader::read_frames(uint32_t first, uint32_t count, uint16_t first_sample, uint16_t sample_count,
+	const OutputLayout& output, void* buffer, size_t buffer_size) noexcept
+{
+	if (_p->good)
+	{
+		return _p->read_frames(first, count, first_sample, sample_count, output, buffer, buffer_size);
+	}
+	return Error::ReaderIsNotGoodYet;
+}
+
+void tiff::reader::Reader::set_max_read_size(size_t bytes) noexcept
+{
+	_p->max_read_size = std::max<size_t>(bytes, 1);
+}
+
+void tiff::reader::Reader::set_decode_threads(uint32_t threads) noexcept
+{
+	_p->decode_threads = threads;
+}
+
+tiff::Error tiff::reader::Reader::set_io_backend(IoBackend backend) noexcept
+{
+#if !TIFF_CXX_HAS_IO_URING
+	if (backend == IoBackend::IoUring)
+	{
+		return Error::IoBackendNotSupport;
+	}
+#endif
+#if !TIFF_CXX_HAS_DIRECT_IO
+	if (backend == IoBackend::Direct)
+	{
+		return Error::IoBackendNotSupport;
+	}
+#endif
+	_p->io_backend = backend;
+	if (_p->file.source != nullptr)
+	{
+		return _p->open_source();
+	}
+	return Error::NoError;
+}
+
+void tiff::reader::Reader::set_half_float(HalfFloat mode) noexcept
+{
+	_p->half_float = mode;
+}
+
+tiff::Error tiff::reader::Reader::set_conversion(const Conversion& conversion) noexcept
+{
+	if (!util::visit_sample_type(conversion.bits_per_sample, conversion.sample_format, [](auto) {}))
+	{
+		return Error::InvalidBitPerSample;
+	}
+	_p->conversion = conversion;
+	return Error::NoError;
+}
+
+void tiff::reader::Reader::clear_conversion() noexcept
+{
+	_p->conversion.reset();
+}
+
+void tiff::reader::Reader::set_expand_palette(bool expand) noexcept
+{
+	_p->expand_palette = expand;
+}
+
+std::vector<uint16_t> tiff::reader::Reader::color_map() const noexcept
+{
+	_p->load_color_map(_p->file.current_frame);
+	return _p->file.current_frame.color_map;
+}
+
+void tiff::reader::Reader::set_convert_color(bool convert) noexcept
+{
+	_p->convert_color = convert;
+}
+
+void tiff::reader::Reader::set_apply_orientation(bool apply) noexcept
+{
+	_p->apply_orientation = apply;
+}
+
+tiff::Orientation tiff::reader::Reader::orientation() const noexcept
+{
+	return _p->file.current_frame.orientation;
+}
+
+void tiff::reader::ByteSource::read_batch(std::vector<ReadRequest>& requests) noexcept
+{
+	for (auto& request : requests)
+	{
+		request.result = read_at(request.offset, request.data, request.size);
+	}
+}
+
+const uint8_t* tiff::reader::ByteSource::data_at(uint64_t, uint64_t) const noexcept
+{
+	return nullptr;
+}
+
+void tiff::reader::ByteSource::advise(uint64_t, uint64_t, AccessHint) noexcept
+{
+}
+
+uint64_t tiff::reader::ByteSource::refresh_size() noexcept
+{
+	return size();
+}
\ No newline at end of file
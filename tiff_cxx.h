@@ -29,6 +29,36 @@ namespace tiff
 		StripDataLost,
 		OpenFileFailed,
 		ReaderIsNotGoodYet,
+
+		WriterIsNotGoodYet,
+		WriteFileFailed,
+		InvalidTileSize,
+		FrameIsNotComplete,
+		FileSizeLimitExceeded,
+
+		LevelNotFound,
+		InvalidRegion,
+		InvalidSampleIndex,
+		BufferTooSmall,
+		InvalidBinFactor,
+		InconsistentFrames,
+		IoBackendNotSupport,
+		InvalidColorMap,
+		InvalidOutputLayout,
+	};
+
+	// where the first stored row and column are when displayed
+	enum class Orientation : uint8_t
+	{
+		TopLeft = 1,
+		TopRight = 2,
+		BottomRight = 3,
+		BottomLeft = 4,
+		LeftTop = 5,
+		RightTop = 6,
+		RightBottom = 7,
+		LeftBottom = 8,
+		Stantard = TopLeft,
 	};
 
 	enum class ResolutionUnit : uint16_t
@@ -48,6 +78,36 @@ namespace tiff
 		Void = Undefined,
 	};
 
+	enum class IoBackend : uint8_t
+	{
+		Stream = 0,  // std::ifstream, available everywhere
+		IoUring = 1, // Linux only, all reads of a decode band are in flight at once, falls back to pread if the kernel refuses rings
+		Mmap = 2,    // the file is mapped and decoded in place, without copying strips or tiles
+		Direct = 3,  // O_DIRECT, reads bypass the page cache so a long scan does not evict it (also uses io_uring when available)
+	};
+
+	enum class HalfFloat : uint8_t
+	{
+		Raw = 0,   // the IEEE half bits as uint16_t samples
+		Float = 1, // widened to float while decoding, with F16C on x86 CPUs that have it
+	};
+
+	enum class BinMode : uint8_t
+	{
+		Mean = 0,
+		Sum = 1,
+		Max = 2,
+		Stride = 3, // keeps the top left sample of every bin
+	};
+
+	enum class ProjectionMode : uint8_t
+	{
+		Max = 0,
+		Min = 1,
+		Sum = 2,
+		Mean = 3,
+	};
+
 	template<typename value_t>
 	struct Vec2
 	{
@@ -57,8 +117,35 @@ namespace tiff
 	typedef Vec2<float> Vec2f;
 	typedef Vec2<unsigned long> Vec2ul;
 
+	struct Rect
+	{
+		uint32_t x = 0;
+		uint32_t y = 0;
+		uint32_t width = 0;
+		uint32_t height = 0;
+	};
+
 	using variant_t = std::variant<uint8_t, uint16_t, uint32_t, uint64_t>;
 
+	struct SampleStatistics
+	{
+		double min = 0.0;
+		double max = 0.0;
+		double sum = 0.0;
+		double sum_of_squares = 0.0;
+		uint64_t count = 0;
+
+		// NaN float samples are only in nan_count, min, max, the sums, count and the histogram skip them
+		uint64_t nan_count = 0;
+
+		// resize `histogram` to the wanted bin count before reading, an empty histogram is skipped.
+		// the bins split [histogram_min, histogram_max] evenly and out of range values go to the first or last bin,
+		// an empty range is replaced with the range of the sample type ([0, 1] for floats)
+		double histogram_min = 0.0;
+		double histogram_max = 0.0;
+		std::vector<uint64_t> histogram{};
+	};
+
 	namespace util
 	{
 		template <typename from_t, typename cast_t>
@@ -73,17 +160,153 @@ namespace tiff
 
 	namespace reader
 	{
+		// one read of a batch, `result` gets the bytes actually read
+		struct ReadRequest
+		{
+			uint64_t offset = 0;
+			uint64_t size = 0;
+			uint8_t* data = nullptr;
+			uint64_t result = 0;
+		};
+
+		// how the reader is about to use a byte range. the stream backend cannot reach the read ahead of its
+		// std::ifstream, so Sequential and Random have no effect there; WillNeed and DontNeed act on the page cache
+		enum class AccessHint : uint8_t
+		{
+			Normal = 0,
+			Sequential = 1, // frames are read one after another
+			Random = 2,     // scattered region reads, reading ahead is wasted
+			WillNeed = 3,   // read soon, worth loading now
+			DontNeed = 4,   // consumed, its cached pages can go
+		};
+
+		// where a Reader gets its bytes from, implement it to read from anything that is not a plain file.
+		// a reader calls its source from one thread at a time, though not always from the same thread
+		class ByteSource
+		{
+		public:
+			virtual ~ByteSource() noexcept = default;
+
+			virtual uint64_t size() const noexcept = 0;
+
+			// copies up to `count` bytes at `offset` into `buffer`, returns how many were copied
+			virtual uint64_t read_at(uint64_t offset, void* buffer, uint64_t count) noexcept = 0;
+
+			// all reads of a decode band at once, the default runs them one by one through read_at
+			virtual void read_batch(std::vector<ReadRequest>& requests) noexcept;
+
+			// the bytes in place if the source holds them in memory (nullptr otherwise), which lets decoding skip the copy
+			virtual const uint8_t* data_at(uint64_t offset, uint64_t count) const noexcept;
+
+			// access pattern hints for sources backed by the page cache, size 0 reaches the end. the default ignores them
+			virtual void advise(uint64_t offset, uint64_t size, AccessHint hint) noexcept;
+
+			// sources that can grow (a file still being written) look up their size again, the default returns size()
+			virtual uint64_t refresh_size() noexcept;
+		};
+
+		// what samples are converted to while they are decoded, see Reader::set_conversion
+		struct Conversion
+		{
+			SampleFormat sample_format = SampleFormat::Float;
+			uint16_t bits_per_sample = 32;
+
+			// out = in * scale + offset, or with normalize out = (in - range_min) / (range_max - range_min) * scale + offset
+			// where an empty range is the range of the input depth ([0, 1] for floats). integer outputs are rounded and saturated
+			bool normalize = false;
+			double range_min = 0.0;
+			double range_max = 0.0;
+			double scale = 1.0;
+			double offset = 0.0;
+		};
+
+		// where read_samples puts sample s of pixel (x, y) of the region: at s * sample_stride + y * row_stride + x * column_stride bytes.
+		// a zero stride is the tightly packed one: column_stride the sample size, row_stride width * column_stride and
+		// sample_stride one whole plane (NCHW). interleaved pixels (NHWC) take column_stride = samples * sample size and
+		// sample_stride = sample size, column major planes take row_stride = sample size and column_stride = height * sample size.
+		// read_frames puts frame f at f * frame_stride bytes, a zero frame_stride is one whole frame of the samples read
+		struct OutputLayout
+		{
+			uint64_t column_stride = 0;
+			uint64_t row_stride = 0;
+			uint64_t sample_stride = 0;
+			uint64_t frame_stride = 0;
+		};
+
+		// the first frame and the frame count of a file, see scan_metadata
+		struct FileMetadata
+		{
+			std::filesystem::path path{};
+			Error error = Error::NoError;
+
+			uint64_t file_size = 0;
+			uint32_t width = 0;
+			uint32_t height = 0;
+			uint16_t bits_per_sample = 0;
+			uint16_t samples_per_pixel = 0;
+			SampleFormat sample_format = SampleFormat::Uint;
+			uint32_t frame_count = 0; // 0 when not counted
+			std::string description{};
+		};
+
+		// reads just the header and first IFD of every file (and walks the IFD chain with count_frames),
+		// `threads` files at a time, 0 for one per hardware thread. results are in the order of `paths`
+		std::vector<FileMetadata> scan_metadata(const std::vector<std::filesystem::path>& paths,
+			bool count_frames = true, uint32_t threads = 0) noexcept;
+
 		class ReaderPrivate;
 		class Reader
 		{
 		public:
 			Reader(std::filesystem::path tiff_path) noexcept;
+			// reads a TIFF held in memory, which must stay valid as long as the reader; nothing is copied
+			Reader(const void* data, size_t size) noexcept;
+			Reader(std::shared_ptr<ByteSource> source) noexcept;
 			~Reader() noexcept;
 
 		public:
 			bool good() const noexcept;
 			Error open() noexcept;
 
+			// adjacent strips are merged into reads of up to `bytes` (4 MiB by default), which is also
+			// about the most strip data held in memory while decoding
+			void set_max_read_size(size_t bytes) noexcept;
+
+			// picks how a reader opened from a path reads the file, readers over memory or a custom source ignore it.
+			// with IoUring raise the max read size to a frame (or more) to have a whole frame in flight
+			Error set_io_backend(IoBackend backend) noexcept;
+
+			// read_frames decodes the frames it has read on this many threads (1 by default, 0 for one per hardware thread)
+			// while the calling thread reads the next ones
+			void set_decode_threads(uint32_t threads) noexcept;
+
+			// how 16 bit float samples are read, HalfFloat::Raw by default. with HalfFloat::Float they are read
+			// as 32 bit floats everywhere, so binning, projections and statistics work on them too
+			void set_half_float(HalfFloat mode) noexcept;
+
+			// converts every sample read from then on, of any depth and format, in the same pass that decodes it.
+			// regions, frames and profiles come out in the converted type, binning, projections and statistics work on it
+			Error set_conversion(const Conversion& conversion) noexcept;
+			void clear_conversion() noexcept;
+
+			// palette images are read as their indices by default. expanded, they read as three 16 bit samples
+			// (red, green and blue from the color map) looked up while decoding, conversions apply to the colors
+			void set_expand_palette(bool expand) noexcept;
+			// the color map of the current frame, all reds, then all greens, then all blues (empty for other images)
+			std::vector<uint16_t> color_map() const noexcept;
+
+			// off by default. on, YCbCr (subsampled ones too) and CMYK images read as red, green and blue samples
+			// (then any extra samples) made from the samples of each pixel while decoding, and WhiteIsZero ones are
+			// inverted to BlackIsZero. needs unsigned samples of up to 16 bits (chunky for YCbCr and CMYK), conversions apply to the colors
+			void set_convert_color(bool convert) noexcept;
+
+			// off by default, frames of every orientation are read in stored order. on, frames, regions, binned reads,
+			// projections and profiles are in display order and width, height and level sizes are the displayed ones
+			// (swapped for the transposed orientations). bins still start at the first stored pixel
+			void set_apply_orientation(bool apply) noexcept;
+			// the orientation of the current frame as stored
+			Orientation orientation() const noexcept;
+
 			uint32_t width() const noexcept;
 			uint32_t height() const noexcept;
 
@@ -93,14 +316,67 @@ namespace tiff
 			Error read_next_frame() const noexcept;
 			uint32_t count_frames() const noexcept;
 
+			// sidecar index for huge stacks: open() takes the frame index (IFD offsets, frame geometry and where the
+			// strip or tile tables are) from `index_path` instead of walking the IFD chain, as long as the file still
+			// has the size, modification time and first bytes the index was saved for
+			void set_index_path(std::filesystem::path index_path) noexcept;
+			// walks the rest of the chain and writes the index to the index path
+			Error save_index() const noexcept;
+
+			// follow mode is for files still being written: has_next_frame and count_frames pick up frames
+			// appended after open as soon as the writer links them into the IFD chain
+			void set_follow(bool follow) noexcept;
+			// in follow mode, waits up to `timeout_ms` for the next frame, true once read_next_frame can read it
+			bool wait_for_next_frame(uint32_t timeout_ms) const noexcept;
+
 			Vec2f resolution() const noexcept;
 			ResolutionUnit resolution_unit() const noexcept;
 
+			// the depth in the file. packed integer depths (1 to 31 bits, FillOrder honoured) are read
+			// widened to the next of 8, 16 or 32 bits, signed ones sign extended
 			uint16_t bits_per_sample() const noexcept;
 			uint16_t samples_per_pixel() const noexcept;
 			SampleFormat sameple_format() const noexcept;
 
 			std::vector<variant_t> get_sample_data(uint16_t sample, Error& err);
+			std::vector<variant_t> get_sample_data(uint16_t sample, Error& err, SampleStatistics& statistics);
+
+			// resolution levels of the current frame, level 0 is the full resolution image
+			// and the reduced ones (SubIFDs or chained NewSubfileType=1 IFDs) follow from large to small
+			uint32_t count_levels() const noexcept;
+			Vec2ul level_size(uint32_t level) const noexcept;
+			uint32_t select_level(uint32_t min_width, uint32_t min_height) const noexcept;
+
+			// region is in level coordinates, samples are written tightly packed in host byte order
+			Error read_region(uint32_t level, uint16_t sample, const Rect& region, void* buffer, size_t buffer_size,
+				SampleStatistics* statistics = nullptr) noexcept;
+			// samples [first_sample, first_sample + sample_count) of a region decoded straight into the strides of `output`,
+			// the strides are multiples of the sample size and must not make samples overlap
+			Error read_samples(uint32_t level, uint16_t first_sample, uint16_t sample_count, const Rect& region,
+				const OutputLayout& output, void* buffer, size_t buffer_size) noexcept;
+
+			// bins factor x factor pixels of the current frame while its strips stream in, the output is
+			// ceil(width / factor) x ceil(height / factor) samples, partial bins at the edges use the pixels they have.
+			// BinMode::Sum writes 64 bit samples (uint64_t, int64_t or double), the other modes keep the sample type
+			Error read_binned(uint16_t sample, uint32_t factor, BinMode mode, void* buffer, size_t buffer_size) noexcept;
+
+			// reduces `count` frames starting at frame `first` (0 counts up to the last frame) pixel by pixel into one
+			// width x height plane, the next frame is read while the current one is reduced. all frames must share the
+			// geometry and sample type; ProjectionMode::Sum writes 64 bit samples like BinMode::Sum, the other modes keep the sample type
+			Error project_frames(uint16_t sample, ProjectionMode mode, uint32_t first, uint32_t count, void* buffer, size_t buffer_size) noexcept;
+
+			// values of a few pixels across `count` frames starting at `first` (0 counts up to the last frame),
+			// the buffer gets count x points.size() samples frame by frame. only the bytes of the requested samples
+			// and the strip or tile table entries they need are read, close requests share a single read
+			Error read_profile(uint16_t sample, const std::vector<Vec2ul>& points, uint32_t first, uint32_t count,
+				void* buffer, size_t buffer_size) noexcept;
+
+			// samples [first_sample, first_sample + sample_count) of `count` frames starting at `first` (0 counts up to the last frame)
+			// decoded into one volume, frame after frame at output.frame_stride and within a frame like read_samples. all frames must
+			// share the displayed size and sample type, which is checked before anything is read. the strips and tiles of many
+			// frames are read at once (up to two such batches are held in memory) and decoded while the next ones are read
+			Error read_frames(uint32_t first, uint32_t count, uint16_t first_sample, uint16_t sample_count, const OutputLayout& output,
+				void* buffer, size_t buffer_size) noexcept;
 
 		private:
 			std::shared_ptr<ReaderPrivate> _p = nullptr;
@@ -109,7 +385,65 @@ namespace tiff
 
 	namespace writer
 	{
-		// TODO
+		enum class PyramidStorage : uint8_t
+		{
+			None = 0,
+			SubIFD = 1,  // reduced levels are referenced by the SubIFDs tag of the full resolution frame
+			Chained = 2, // reduced levels follow the full resolution frame in the main IFD chain
+		};
+
+		enum class Downsampling : uint8_t
+		{
+			Mean = 0,    // 2x2 box mean
+			Nearest = 1, // top left pixel of every 2x2 block
+		};
+
+		struct FrameInfo
+		{
+			uint32_t width = 0;
+			uint32_t height = 0;
+			uint16_t bits_per_sample = 8;
+			uint16_t samples_per_pixel = 1;
+			SampleFormat sample_format = SampleFormat::Uint;
+
+			// 0 picks strips of about 256 KiB
+			uint32_t rows_per_strip = 0;
+
+			// non-zero tile size writes tiles instead of strips, must be multiples of 16
+			uint32_t tile_width = 0;
+			uint32_t tile_length = 0;
+
+			// count of reduced resolution levels written below the full resolution frame, each halves the size
+			uint32_t pyramid_levels = 0;
+			PyramidStorage pyramid_storage = PyramidStorage::SubIFD;
+			Downsampling downsampling = Downsampling::Mean;
+
+			std::string description{};
+		};
+
+		class WriterPrivate;
+		class Writer
+		{
+		public:
+			Writer(std::filesystem::path tiff_path) noexcept;
+			~Writer() noexcept;
+
+		public:
+			bool good() const noexcept;
+			Error open() noexcept;
+			// a file without a complete frame is no valid tiff, closing it fails with FrameIsNotComplete and removes it
+			Error close() noexcept;
+
+			// rows are interleaved samples in host byte order, the pyramid levels are built while rows stream in
+			Error begin_frame(const FrameInfo& info) noexcept;
+			Error write_rows(const void* data, uint32_t rows) noexcept;
+			Error end_frame() noexcept;
+
+			Error write_frame(const FrameInfo& info, const void* data) noexcept;
+
+		private:
+			std::shared_ptr<WriterPrivate> _p = nullptr;
+		};
 	}
 }
 